@@ -16,6 +16,26 @@
 #include <iostream>
 #include <vector>
 #include <ctime>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <array>
+#include <chrono>
+#include <span>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+// Сбор статистики обработчиков; включается определением CHAIN_STATISTICS=1
+#ifndef CHAIN_STATISTICS
+#define CHAIN_STATISTICS 0
+#endif
 
  // Концепция паттерна "Цепочка Обязанностей"
 namespace Behavioral {
@@ -110,6 +130,806 @@ namespace Behavioral {
         }
     };
 
+    // Статистика обработчиков
+    //--------------------------------------------------------------
+    // Для каждого звена считаются обработанные и переданные дальше запросы и
+    // гистограмма времени шага в духе HDR: логарифмические корзины по степеням
+    // двойки, каждая разбита на 8 линейных (погрешность не больше 12.5%).
+    // Запись - одно атомарное приращение без блокировок, но чтение часов на
+    // каждом шаге заметно дороже самого поиска в таблице, поэтому сбор включается
+    // только определением CHAIN_STATISTICS=1; без него не стоит ничего.
+
+    class HistogramSnapshot {
+    public:
+        static constexpr unsigned sub_bits = 3;
+        static constexpr std::size_t sub_count = std::size_t(1) << sub_bits;
+        static constexpr std::size_t buckets = (64 - sub_bits + 1) * sub_count;
+
+        static std::size_t Index(std::uint64_t value) {
+            if (value < sub_count) return std::size_t(value);
+            unsigned shift = unsigned(std::bit_width(value)) - 1 - sub_bits;
+            return (shift + 1) * sub_count + std::size_t((value >> shift) & (sub_count - 1));
+        }
+        // Наибольшее значение, попадающее в корзину
+        static std::uint64_t UpperBound(std::size_t index) {
+            if (index < 2 * sub_count) return index;
+            unsigned shift = unsigned(index / sub_count) - 1;
+            std::uint64_t low = (sub_count + index % sub_count) << shift;
+            return low + ((std::uint64_t(1) << shift) - 1);
+        }
+
+        std::uint64_t Count() const {
+            std::uint64_t total = 0;
+            for (std::uint64_t count : counts) total += count;
+            return total;
+        }
+        // Значение, не превышаемое долей fraction (0..1) измерений
+        std::uint64_t Percentile(double fraction) const {
+            std::uint64_t total = Count();
+            if (total == 0) return 0;
+            std::uint64_t rank = std::max<std::uint64_t>(1, std::uint64_t(fraction * double(total) + 0.5));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < buckets; ++i)
+                if ((seen += counts[i]) >= rank) return UpperBound(i);
+            return UpperBound(buckets - 1);
+        }
+
+        std::array<std::uint64_t, buckets> counts{};
+    };
+
+    class LatencyHistogram {
+    public:
+        void Record(std::uint64_t nanoseconds, std::uint64_t times = 1) {
+            counts[HistogramSnapshot::Index(nanoseconds)].fetch_add(times, std::memory_order_relaxed);
+        }
+        HistogramSnapshot Snapshot() const {
+            HistogramSnapshot snapshot;
+            for (std::size_t i = 0; i < counts.size(); ++i)
+                snapshot.counts[i] = counts[i].load(std::memory_order_relaxed);
+            return snapshot;
+        }
+    private:
+        std::array<std::atomic<std::uint64_t>, HistogramSnapshot::buckets> counts{};
+    };
+
+    struct HandlerStatistics {
+        std::atomic<std::uint64_t> handled{ 0 };
+        std::atomic<std::uint64_t> forwarded{ 0 };
+        LatencyHistogram latency;   // время шага в наносекундах
+    };
+
+    struct HandlerReport {
+        std::uint64_t handled;
+        std::uint64_t forwarded;
+        HistogramSnapshot latency;
+    };
+
+    struct ChainReport {
+        std::uint64_t requests;
+        std::uint64_t unhandled;   // дошли до конца цепочки без обработчика
+        std::vector<HandlerReport> handlers;
+
+        double UnhandledShare() const { return requests ? double(unhandled) / double(requests) : 0.0; }
+    };
+
+    // Скомпилированная цепочка обязанностей
+    //--------------------------------------------------------------
+    // Обработчик заранее сообщает, какие виды запросов он принимает, поэтому
+    // цепочка может построить таблицу "вид запроса -> обработчик" и находить
+    // получателя за O(1), не обходя список. Обработчики с произвольным условием
+    // (Matches) по-прежнему проверяются по порядку, но только те из них, что
+    // стоят в цепочке раньше табличного обработчика данного вида.
+
+    struct ChainRequest {
+        std::uint32_t kind;
+        std::int64_t payload;
+    };
+
+    class RequestHandler abstract {
+    public:
+        virtual ~RequestHandler() = default;
+
+        // Обработка принятого запроса
+        virtual void Handle(const ChainRequest& request) = 0;
+
+        // Обработка пачки принятых запросов; переопределяется, когда пачку
+        // можно обработать выгоднее, чем по одному
+        virtual void HandleBatch(std::span<const ChainRequest> requests) {
+            for (const ChainRequest& request : requests)
+                Handle(request);
+        }
+
+        bool IsConditional() const { return conditional; }
+        const std::vector<std::uint32_t>& GetKinds() const { return kinds; }
+
+        // Принимает ли обработчик запрос - по виду или по условию
+        bool Accepts(const ChainRequest& request) const {
+            if (conditional) return Matches(request);
+            return std::find(kinds.begin(), kinds.end(), request.kind) != kinds.end();
+        }
+
+#if CHAIN_STATISTICS
+        HandlerStatistics& Statistics() { return statistics; }
+        HandlerReport Report() const {
+            return { statistics.handled.load(std::memory_order_relaxed),
+                statistics.forwarded.load(std::memory_order_relaxed), statistics.latency.Snapshot() };
+        }
+#else
+        HandlerReport Report() const { return {}; }
+#endif
+    protected:
+        // Обработчик, принимающий перечисленные виды запросов
+        RequestHandler(std::initializer_list<std::uint32_t> kinds) : kinds(kinds), conditional(false) {}
+        // Обработчик с условием: решение принимает Matches()
+        RequestHandler() : conditional(true) {}
+
+        virtual bool Matches(const ChainRequest&) const { return false; }
+    private:
+        std::vector<std::uint32_t> kinds;
+        bool conditional;
+#if CHAIN_STATISTICS
+        HandlerStatistics statistics;
+#endif
+    };
+
+    // Засекает шаги одного запроса: одно чтение часов на каждую границу шага
+    class HopTimer {
+    public:
+#if CHAIN_STATISTICS
+        HopTimer() : last(std::chrono::steady_clock::now()) {}
+        void Forwarded(RequestHandler* handler) { Hop(handler->Statistics().forwarded, handler); }
+        void Handled(RequestHandler* handler) { Hop(handler->Statistics().handled, handler); }
+    private:
+        void Hop(std::atomic<std::uint64_t>& counter, RequestHandler* handler) {
+            auto now = std::chrono::steady_clock::now();
+            counter.fetch_add(1, std::memory_order_relaxed);
+            handler->Statistics().latency.Record(std::uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count()));
+            last = now;
+        }
+        std::chrono::steady_clock::time_point last;
+#else
+        void Forwarded(RequestHandler*) {}
+        void Handled(RequestHandler*) {}
+#endif
+    };
+
+    class RequestChain {
+    public:
+        // Добавляет обработчик в конец цепочки; таблица при этом сбрасывается
+        RequestChain& Add(RequestHandler* handler) {
+            handlers.push_back(handler);
+            table.clear();
+            sparse.clear();
+            conditionals.clear();
+            conditional_positions.clear();
+            compiled = false;
+            return *this;
+        }
+
+        // Строит таблицу видов запросов. Первый по порядку обработчик вида
+        // побеждает, как и при обходе; условные обработчики перед ним запоминаются.
+        // Виды меньше dense_kinds лежат в массиве, остальные - в хеш-таблице,
+        // чтобы один большой номер вида не раздувал массив.
+        void Compile() {
+            table.clear();
+            sparse.clear();
+            conditionals.clear();
+            conditional_positions.clear();
+            for (std::uint32_t position = 0; position < handlers.size(); ++position) {
+                RequestHandler* handler = handlers[position];
+                if (handler->IsConditional()) {
+                    conditionals.push_back(handler);
+                    conditional_positions.push_back(position);
+                    continue;
+                }
+                for (std::uint32_t kind : handler->GetKinds()) {
+                    Entry entry{ handler, std::uint32_t(conditionals.size()), position };
+                    if (kind >= dense_kinds) {
+                        sparse.emplace(kind, entry);
+                        continue;
+                    }
+                    if (kind >= table.size())
+                        table.resize(std::size_t(kind) + 1, { nullptr, 0, nowhere });
+                    if (!table[kind].handler)
+                        table[kind] = entry;
+                }
+            }
+            // Виды без табличного обработчика проверяют все условные обработчики
+            for (Entry& entry : table)
+                if (!entry.handler) entry.conditionals = std::uint32_t(conditionals.size());
+            compiled = true;
+        }
+        bool IsCompiled() const { return compiled; }
+
+        // Передаёт запрос первому подходящему обработчику; false - обработчика нет.
+        // Не меняет цепочку, поэтому может вызываться из нескольких потоков.
+        bool HandleRequest(const ChainRequest& request) const {
+            HopTimer timer;
+            RequestHandler* handler = compiled ? Lookup(request, timer) : Find(request, timer);
+#if CHAIN_STATISTICS
+            requests.fetch_add(1, std::memory_order_relaxed);
+            if (!handler) unhandled.fetch_add(1, std::memory_order_relaxed);
+#endif
+            if (!handler) return false;
+            handler->Handle(request);
+            timer.Handled(handler);
+            return true;
+        }
+
+        // Пакетная обработка: на каждом звене пачка делится на принятые запросы,
+        // которые звено получает одним вызовом HandleBatch(), и остаток, идущий
+        // дальше. В скомпилированном режиме запросы раскладываются по
+        // обработчикам за один проход. Возвращает число необработанных запросов.
+        std::size_t HandleBatch(std::span<const ChainRequest> batch) {
+            std::size_t left = compiled ? DispatchBatch(batch) : PartitionBatch(batch);
+#if CHAIN_STATISTICS
+            requests.fetch_add(batch.size(), std::memory_order_relaxed);
+            unhandled.fetch_add(left, std::memory_order_relaxed);
+#endif
+            return left;
+        }
+
+        // Обход по порядку, как в исходной цепочке
+        RequestHandler* Traverse(const ChainRequest& request) const {
+            for (RequestHandler* handler : handlers)
+                if (handler->Accepts(request)) return handler;
+            return nullptr;
+        }
+
+        std::size_t size() const { return handlers.size(); }
+
+        // Снимок статистики; обработчики - в порядке цепочки.
+        // Переданными считаются только запросы, которые обработчик действительно
+        // проверил: в скомпилированном режиме табличные обработчики чужих видов не участвуют.
+        // Без CHAIN_STATISTICS=1 счётчиков нет, и отчёт нулевой.
+        ChainReport Report() const {
+#if CHAIN_STATISTICS
+            ChainReport report{ requests.load(std::memory_order_relaxed), unhandled.load(std::memory_order_relaxed), {} };
+#else
+            ChainReport report{ 0, 0, {} };
+#endif
+            for (RequestHandler* handler : handlers)
+                report.handlers.push_back(handler->Report());
+            return report;
+        }
+    private:
+        struct Entry {
+            RequestHandler* handler;
+            std::uint32_t conditionals;   // сколько условных обработчиков стоит раньше
+            std::uint32_t position;       // место обработчика в цепочке
+        };
+
+        static constexpr std::uint32_t nowhere = std::uint32_t(-1);
+        static constexpr std::uint32_t dense_kinds = std::uint32_t(1) << 16;
+
+#if CHAIN_STATISTICS
+        // Статистика шага для целой пачки: время делится поровну между запросами
+        static void RecordBatch(RequestHandler* handler, std::size_t handled, std::size_t forwarded,
+            std::chrono::steady_clock::time_point start) {
+            std::size_t total = handled + forwarded;
+            if (total == 0) return;
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            HandlerStatistics& statistics = handler->Statistics();
+            statistics.handled.fetch_add(handled, std::memory_order_relaxed);
+            statistics.forwarded.fetch_add(forwarded, std::memory_order_relaxed);
+            statistics.latency.Record(std::uint64_t(elapsed) / total, total);
+        }
+#endif
+
+        std::size_t PartitionBatch(std::span<const ChainRequest> batch) {
+            pending.assign(batch.begin(), batch.end());
+            for (RequestHandler* handler : handlers) {
+                if (pending.empty()) break;
+#if CHAIN_STATISTICS
+                auto start = std::chrono::steady_clock::now();
+#endif
+                accepted.clear();
+                rest.clear();
+                for (const ChainRequest& request : pending)
+                    (handler->Accepts(request) ? accepted : rest).push_back(request);
+                if (!accepted.empty())
+                    handler->HandleBatch(accepted);
+#if CHAIN_STATISTICS
+                RecordBatch(handler, accepted.size(), rest.size(), start);
+#endif
+                pending.swap(rest);
+            }
+            return pending.size();
+        }
+
+        std::size_t DispatchBatch(std::span<const ChainRequest> batch) {
+            // Место обработчика для каждого запроса, затем раскладка подсчётом
+            targets.resize(batch.size());
+            offsets.assign(handlers.size() + 1, 0);
+#if CHAIN_STATISTICS
+            forwards.assign(conditionals.size(), 0);
+#endif
+            std::size_t left = 0;
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                targets[i] = LookupPosition(batch[i]);
+                if (targets[i] == nowhere) ++left;
+                else ++offsets[targets[i] + 1];
+            }
+            for (std::size_t i = 1; i < offsets.size(); ++i)
+                offsets[i] += offsets[i - 1];
+            accepted.resize(offsets.back());
+            for (std::size_t i = 0; i < batch.size(); ++i)
+                if (targets[i] != nowhere) accepted[offsets[targets[i]]++] = batch[i];
+            // После раскладки offsets[p] указывает на конец группы p; пустые группы пропускаются
+            std::size_t begin = 0;
+            for (std::size_t p = 0; p < handlers.size(); ++p) {
+                std::size_t end = offsets[p];
+                if (end == begin) continue;
+#if CHAIN_STATISTICS
+                auto start = std::chrono::steady_clock::now();
+#endif
+                handlers[p]->HandleBatch(std::span<const ChainRequest>(accepted).subspan(begin, end - begin));
+#if CHAIN_STATISTICS
+                RecordBatch(handlers[p], end - begin, 0, start);
+#endif
+                begin = end;
+            }
+#if CHAIN_STATISTICS
+            for (std::size_t i = 0; i < conditionals.size(); ++i)
+                conditionals[i]->Statistics().forwarded.fetch_add(forwards[i], std::memory_order_relaxed);
+#endif
+            return left;
+        }
+
+        // Запись таблицы для вида; nullptr - вида нет ни в массиве, ни в хеш-таблице
+        const Entry* FindEntry(std::uint32_t kind) const {
+            if (kind < table.size()) return &table[kind];
+            if (kind < dense_kinds || sparse.empty()) return nullptr;
+            auto found = sparse.find(kind);
+            return found == sparse.end() ? nullptr : &found->second;
+        }
+
+        std::uint32_t LookupPosition(const ChainRequest& request) {
+            const Entry* entry = FindEntry(request.kind);
+            std::uint32_t count = entry ? entry->conditionals : std::uint32_t(conditionals.size());
+            for (std::uint32_t i = 0; i < count; ++i) {
+                if (conditionals[i]->Accepts(request)) return conditional_positions[i];
+#if CHAIN_STATISTICS
+                ++forwards[i];
+#endif
+            }
+            return entry ? entry->position : nowhere;
+        }
+
+        RequestHandler* Find(const ChainRequest& request, HopTimer& timer) const {
+            for (RequestHandler* handler : handlers) {
+                if (handler->Accepts(request)) return handler;
+                timer.Forwarded(handler);
+            }
+            return nullptr;
+        }
+
+        RequestHandler* Lookup(const ChainRequest& request, HopTimer& timer) const {
+            const Entry* entry = FindEntry(request.kind);
+            std::uint32_t count = entry ? entry->conditionals : std::uint32_t(conditionals.size());
+            for (std::uint32_t i = 0; i < count; ++i) {
+                if (conditionals[i]->Accepts(request)) return conditionals[i];
+                timer.Forwarded(conditionals[i]);
+            }
+            return entry ? entry->handler : nullptr;
+        }
+
+        std::vector<RequestHandler*> handlers;
+        std::vector<Entry> table;                              // виды меньше dense_kinds
+        std::unordered_map<std::uint32_t, Entry> sparse;       // остальные виды
+        std::vector<RequestHandler*> conditionals;
+        std::vector<std::uint32_t> conditional_positions;
+        bool compiled = false;
+        // Рабочие буферы пакетной обработки, чтобы не выделять память на каждую пачку
+        std::vector<ChainRequest> pending, accepted, rest;
+        std::vector<std::uint32_t> targets;
+        std::vector<std::size_t> offsets;
+#if CHAIN_STATISTICS
+        std::vector<std::uint64_t> forwards;                   // проверки условных обработчиков в пачке
+        mutable std::atomic<std::uint64_t> requests{ 0 };
+        mutable std::atomic<std::uint64_t> unhandled{ 0 };
+#endif
+    };
+
+    // Цепочка с заменой на лету
+    //--------------------------------------------------------------
+    // Состав цепочки публикуется целиком как неизменяемая скомпилированная
+    // версия (RCU): читатели берут текущую версию без блокировок, писатель
+    // подменяет указатель одной атомарной операцией. Старая версия удаляется,
+    // когда закончились все запросы, которые могли её видеть, - это отслеживается
+    // по эпохам: читатель отмечает в своей ячейке эпоху, в которую вошёл.
+
+    class SwappableChain {
+    public:
+        static constexpr std::size_t reader_slots = 64;
+
+        explicit SwappableChain(const std::vector<RequestHandler*>& handlers = {}) {
+            current.store(Build(handlers), std::memory_order_release);
+        }
+        ~SwappableChain() {
+            delete current.load(std::memory_order_relaxed);
+            for (const Retired& retired : retired) delete retired.chain;
+        }
+
+        SwappableChain(const SwappableChain&) = delete;
+        SwappableChain& operator=(const SwappableChain&) = delete;
+
+        // Публикует новый состав. Запросы в пути дорабатывают по старому;
+        // убранный обработчик можно удалять, когда Reclaim() вернёт 0.
+        void Publish(const std::vector<RequestHandler*>& handlers) {
+            RequestChain* fresh = Build(handlers);
+            std::lock_guard<std::mutex> lock(writer);
+            RequestChain* old = current.exchange(fresh, std::memory_order_seq_cst);
+            retired.push_back({ old, epoch.fetch_add(1, std::memory_order_seq_cst) });
+            ReclaimLocked();
+        }
+
+        // Безопасен из любого числа потоков одновременно с Publish()
+        bool HandleRequest(const ChainRequest& request) const {
+            ReadGuard guard(*this);
+            return current.load(std::memory_order_seq_cst)->HandleRequest(request);
+        }
+
+        // Удаляет версии, которые больше никто не читает; возвращает число оставшихся
+        std::size_t Reclaim() {
+            std::lock_guard<std::mutex> lock(writer);
+            return ReclaimLocked();
+        }
+    private:
+        struct Retired {
+            RequestChain* chain;
+            std::uint64_t epoch;   // эпоха, в которой версия была снята с публикации
+        };
+
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> epoch{ 0 };   // 0 - ячейка свободна
+        };
+
+        // Занимает свободную ячейку читателя на время одного запроса
+        class ReadGuard {
+        public:
+            explicit ReadGuard(const SwappableChain& chain) {
+                std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+                for (std::size_t i = 0;; ++i) {
+                    slot = &chain.slots[(start + i) % reader_slots];
+                    std::uint64_t free = 0;
+                    if (slot->epoch.compare_exchange_strong(free, chain.epoch.load(std::memory_order_seq_cst),
+                        std::memory_order_seq_cst))
+                        return;
+                    if (i % reader_slots == reader_slots - 1) std::this_thread::yield();
+                }
+            }
+            ~ReadGuard() { slot->epoch.store(0, std::memory_order_release); }
+
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+        private:
+            Slot* slot;
+        };
+
+        static RequestChain* Build(const std::vector<RequestHandler*>& handlers) {
+            auto chain = std::make_unique<RequestChain>();
+            for (RequestHandler* handler : handlers) chain->Add(handler);
+            chain->Compile();
+            return chain.release();
+        }
+
+        // Версию, снятую в эпоху E, мог видеть только читатель, вошедший в эпоху <= E
+        std::size_t ReclaimLocked() {
+            std::uint64_t oldest = std::uint64_t(-1);
+            for (const Slot& slot : slots) {
+                std::uint64_t entered = slot.epoch.load(std::memory_order_seq_cst);
+                if (entered != 0) oldest = std::min(oldest, entered);
+            }
+            auto done = std::remove_if(retired.begin(), retired.end(), [oldest](const Retired& r) {
+                if (r.epoch >= oldest) return false;
+                delete r.chain;
+                return true;
+            });
+            retired.erase(done, retired.end());
+            return retired.size();
+        }
+
+        std::atomic<RequestChain*> current{ nullptr };
+        mutable std::atomic<std::uint64_t> epoch{ 1 };
+        mutable std::array<Slot, reader_slots> slots;
+        std::mutex writer;
+        std::vector<Retired> retired;
+    };
+
+    // Самонастраивающаяся цепочка
+    //--------------------------------------------------------------
+    // Если порядок нескольких соседних обработчиков не влияет на результат
+    // (они помечены как перестановочные), цепочка считает, как часто каждый из
+    // них принимает запросы, и периодически переставляет их так, чтобы частые
+    // стояли раньше. Счётчики затухают (делятся пополам при каждой перестановке),
+    // поэтому порядок следует за сменой нагрузки. Неперестановочный обработчик
+    // остаётся на своём месте и разделяет группы.
+
+    class AdaptiveChain {
+    public:
+        explicit AdaptiveChain(std::uint64_t period = 4096) : period(period) {}
+
+        AdaptiveChain& Add(RequestHandler* handler, bool commutative = false) {
+            links.push_back({ handler, commutative, 0 });
+            return *this;
+        }
+
+        bool HandleRequest(const ChainRequest& request) {
+            if (++since_reorder == period) Reorder();
+            ++requests;
+            for (std::size_t i = 0; i < links.size(); ++i) {
+                Link& link = links[i];
+                if (!link.handler->Accepts(request)) continue;
+                hops += i + 1;
+                ++link.hits;
+                link.handler->Handle(request);
+                return true;
+            }
+            hops += links.size();
+            return false;
+        }
+
+        // Упорядочивает каждую группу перестановочных обработчиков по убыванию попаданий
+        void Reorder() {
+            since_reorder = 0;
+            for (auto first = links.begin(); first != links.end();) {
+                auto last = std::find_if(first, links.end(), [](const Link& link) { return !link.commutative; });
+                std::stable_sort(first, last, [](const Link& a, const Link& b) { return a.hits > b.hits; });
+                first = last == links.end() ? last : last + 1;
+            }
+            for (Link& link : links) link.hits /= 2;
+        }
+
+        // Среднее число проверенных обработчиков на запрос
+        double AverageHops() const { return requests ? double(hops) / double(requests) : 0.0; }
+        void ResetHops() { hops = requests = 0; }
+
+        std::vector<RequestHandler*> Order() const {
+            std::vector<RequestHandler*> order;
+            for (const Link& link : links) order.push_back(link.handler);
+            return order;
+        }
+    private:
+        struct Link {
+            RequestHandler* handler;
+            bool commutative;
+            std::uint64_t hits;
+        };
+
+        std::vector<Link> links;
+        std::uint64_t period;
+        std::uint64_t since_reorder = 0;
+        std::uint64_t requests = 0;
+        std::uint64_t hops = 0;
+    };
+
+    // Обработчики для примера: по виду запроса и по условию на данные
+    class KindHandler : public RequestHandler {
+    public:
+        KindHandler(const char* name, std::initializer_list<std::uint32_t> kinds) : RequestHandler(kinds), name(name) {}
+        void Handle(const ChainRequest& request) override {
+            std::cout << name << ".HandleRequest(" << request.payload << ")\n";
+        }
+    private:
+        const char* name;
+    };
+
+    // Обработчик без вывода - для объёмных примеров
+    class NullHandler : public RequestHandler {
+    public:
+        NullHandler(std::initializer_list<std::uint32_t> kinds) : RequestHandler(kinds) {}
+        void Handle(const ChainRequest&) override {}
+    };
+
+    class LargePayloadHandler : public RequestHandler {
+    public:
+        explicit LargePayloadHandler(std::int64_t limit) : limit(limit) {}
+        void Handle(const ChainRequest& request) override {
+            std::cout << "LargePayloadHandler.HandleRequest(" << request.payload << ")\n";
+        }
+    protected:
+        bool Matches(const ChainRequest& request) const override { return request.payload > limit; }
+    private:
+        std::int64_t limit;
+    };
+
+    // Конвейерная цепочка
+    //--------------------------------------------------------------
+    // Каждый обработчик работает в своём потоке; между соседними звеньями -
+    // ограниченная очередь "один писатель - один читатель". Звено либо
+    // обрабатывает запрос, либо передаёт его следующему, поэтому разные запросы
+    // одновременно находятся на разных звеньях.
+
+    template <class T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(std::size_t capacity) : items(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {}
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        // Только для потока-писателя
+        bool TryPush(const T& item) {
+            std::uint64_t t = tail.load(std::memory_order_relaxed);
+            if (t - cached_head == items.size()) {
+                cached_head = head.load(std::memory_order_acquire);
+                if (t - cached_head == items.size()) return false;
+            }
+            items[t & (items.size() - 1)] = item;
+            tail.store(t + 1, std::memory_order_seq_cst);
+            if (consumer_waiting.load(std::memory_order_seq_cst)) tail.notify_one();
+            return true;
+        }
+        // Ждёт свободного места: сначала активно, затем засыпает
+        void Push(const T& item) {
+            for (int spin = 0; !TryPush(item); ++spin) {
+                if (spin < spin_limit) { std::this_thread::yield(); continue; }
+                std::uint64_t h = head.load(std::memory_order_seq_cst);
+                producer_waiting.store(true, std::memory_order_seq_cst);
+                if (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_seq_cst) == items.size())
+                    head.wait(h, std::memory_order_acquire);
+                producer_waiting.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        // Только для потока-читателя
+        bool TryPop(T& item) {
+            std::uint64_t h = head.load(std::memory_order_relaxed);
+            if (h == cached_tail) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (h == cached_tail) return false;
+            }
+            item = items[h & (items.size() - 1)];
+            head.store(h + 1, std::memory_order_seq_cst);
+            if (producer_waiting.load(std::memory_order_seq_cst)) head.notify_one();
+            return true;
+        }
+        T Pop() {
+            T item;
+            for (int spin = 0; !TryPop(item); ++spin) {
+                if (spin < spin_limit) { std::this_thread::yield(); continue; }
+                std::uint64_t h = head.load(std::memory_order_relaxed);
+                consumer_waiting.store(true, std::memory_order_seq_cst);
+                if (tail.load(std::memory_order_seq_cst) == h)
+                    tail.wait(h, std::memory_order_acquire);
+                consumer_waiting.store(false, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // Приблизительное число элементов (точное, если очередь не меняется)
+        std::size_t size() const {
+            std::uint64_t h = head.load(std::memory_order_acquire);
+            return std::size_t(tail.load(std::memory_order_acquire) - h);
+        }
+        std::size_t capacity() const { return items.size(); }
+    private:
+        static constexpr int spin_limit = 64;
+
+        std::vector<T> items;
+        alignas(64) std::atomic<std::uint64_t> head{ 0 };
+        std::atomic<bool> producer_waiting{ false };
+        std::uint64_t cached_tail = 0;
+        alignas(64) std::atomic<std::uint64_t> tail{ 0 };
+        std::atomic<bool> consumer_waiting{ false };
+        std::uint64_t cached_head = 0;
+    };
+
+    struct StageMetrics {
+        std::uint64_t handled;
+        std::uint64_t forwarded;
+        std::size_t depth;        // запросов в очереди перед звеном сейчас
+        std::size_t peak_depth;   // наибольшая замеченная глубина очереди
+    };
+
+    class RequestPipeline {
+    public:
+        // Submit() должен вызываться из одного потока: первая очередь - тоже SPSC
+        RequestPipeline(std::vector<RequestHandler*> handlers, std::size_t queue_capacity = 1024) {
+            if (handlers.empty())
+                throw std::invalid_argument("Pipeline needs at least one handler");
+            for (RequestHandler* handler : handlers)
+                stages.push_back(std::make_unique<Stage>(handler, queue_capacity));
+            for (std::size_t i = 0; i < stages.size(); ++i)
+                stages[i]->worker = std::thread([this, i] { Run(i); });
+        }
+        ~RequestPipeline() { Close(); }
+
+        RequestPipeline(const RequestPipeline&) = delete;
+        RequestPipeline& operator=(const RequestPipeline&) = delete;
+
+        void Submit(const ChainRequest& request) {
+            if (closed)
+                throw std::logic_error("Pipeline is closed");
+            ++submitted;
+            Enqueue(*stages.front(), { request, false });
+        }
+
+        // Ждёт, пока все отправленные запросы пройдут конвейер
+        void Drain() const {
+            while (completed.load(std::memory_order_acquire) != submitted)
+                std::this_thread::yield();
+        }
+
+        // Дообрабатывает очередь и останавливает потоки
+        void Close() {
+            if (closed) return;
+            closed = true;
+            Enqueue(*stages.front(), { {}, true });
+            for (auto& stage : stages) stage->worker.join();
+        }
+
+        std::vector<StageMetrics> Metrics() const {
+            std::vector<StageMetrics> metrics;
+            for (const auto& stage : stages)
+                metrics.push_back({ stage->handled.load(std::memory_order_relaxed),
+                    stage->forwarded.load(std::memory_order_relaxed),
+                    stage->queue.size(), stage->peak_depth.load(std::memory_order_relaxed) });
+            return metrics;
+        }
+        // Запросы, которые не обработал ни один обработчик
+        std::uint64_t Unhandled() const {
+            return stages.back()->forwarded.load(std::memory_order_relaxed);
+        }
+    private:
+        struct Item {
+            ChainRequest request;
+            bool stop;
+        };
+
+        struct Stage {
+            Stage(RequestHandler* handler, std::size_t capacity) : handler(handler), queue(capacity) {}
+
+            RequestHandler* handler;
+            SpscQueue<Item> queue;
+            std::atomic<std::uint64_t> handled{ 0 };
+            std::atomic<std::uint64_t> forwarded{ 0 };
+            std::atomic<std::size_t> peak_depth{ 0 };
+            std::thread worker;
+        };
+
+        static void Enqueue(Stage& stage, const Item& item) {
+            stage.queue.Push(item);
+            std::size_t depth = stage.queue.size();
+            if (depth > stage.peak_depth.load(std::memory_order_relaxed))
+                stage.peak_depth.store(depth, std::memory_order_relaxed);
+        }
+
+        void Run(std::size_t index) {
+            Stage& stage = *stages[index];
+            Stage* next = index + 1 < stages.size() ? stages[index + 1].get() : nullptr;
+            for (;;) {
+                Item item = stage.queue.Pop();
+                if (item.stop) {
+                    if (next) Enqueue(*next, item);
+                    return;
+                }
+                HopTimer timer;
+                if (stage.handler->Accepts(item.request)) {
+                    stage.handler->Handle(item.request);
+                    timer.Handled(stage.handler);
+                    stage.handled.fetch_add(1, std::memory_order_relaxed);
+                    completed.fetch_add(1, std::memory_order_release);
+                    continue;
+                }
+                stage.forwarded.fetch_add(1, std::memory_order_relaxed);
+                timer.Forwarded(stage.handler);
+                if (next)
+                    Enqueue(*next, item);
+                else
+                    completed.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        std::vector<std::unique_ptr<Stage>> stages;
+        std::uint64_t submitted = 0;
+        std::atomic<std::uint64_t> completed{ 0 };
+        bool closed = false;
+    };
+
     void test_chain() {
         // Код клиента.
         // 1. Создать цепочку из трех обработчиков, задать им соответствующий номер обработки
@@ -149,5 +969,241 @@ namespace Behavioral {
                 break;
             }
         }
+
+        // Скомпилированная цепочка: виды 1..3 находятся по таблице,
+        // условный обработчик перехватывает большие запросы вида 2 и 3
+        KindHandler k1("ConcreteHandler1", { 1 });
+        LargePayloadHandler large(1000);
+        KindHandler k2("ConcreteHandler2", { 2 });
+        KindHandler k3("ConcreteHandler3", { 3 });
+        RequestChain chain;
+        chain.Add(&k1).Add(&large).Add(&k2).Add(&k3);
+        chain.Compile();
+        ChainRequest requests[] = { { 1, 5000 }, { 2, 10 }, { 3, 5000 }, { 4, 10 } };
+        for (const ChainRequest& request : requests)
+            if (!chain.HandleRequest(request))
+                std::cout << "There is no corresponding handler in the chain.\n";
+#if CHAIN_STATISTICS
+        ChainReport report = chain.Report();
+        for (std::size_t i = 0; i < report.handlers.size(); ++i)
+            std::cout << "Handler " << i + 1 << ": handled " << report.handlers[i].handled
+                << ", forwarded " << report.handlers[i].forwarded
+                << ", p99 " << report.handlers[i].latency.Percentile(0.99) << " ns\n";
+        std::cout << "Unhandled share: " << report.UnhandledShare() << "\n";
+#endif
+
+        // Та же цепочка, но вся пачка за один проход: по вызову на обработчик
+        std::size_t left = chain.HandleBatch(requests);
+        std::cout << "Unhandled in batch: " << left << "\n";
+
+        // Замена состава цепочки без остановки потока запросов
+        SwappableChain live({ &k1, &k2 });
+        std::cout << "Kind 3 before swap: " << live.HandleRequest({ 3, 1 }) << "\n";
+        live.Publish({ &k1, &k2, &k3 });
+        std::cout << "Kind 3 after swap: " << live.HandleRequest({ 3, 1 }) << "\n";
+        std::cout << "Versions left: " << live.Reclaim() << "\n";
+
+        // Самонастройка: почти весь поток идёт третьему обработчику
+        NullHandler n1({ 1 }), n2({ 2 }), n3({ 3 });
+        AdaptiveChain adaptive(64);
+        adaptive.Add(&n1, true).Add(&n2, true).Add(&n3, true);
+        for (int i = 0; i < 1000; ++i)
+            adaptive.HandleRequest({ i % 10 == 0 ? 1u : 3u, i });
+        std::cout << "Average hops: " << adaptive.AverageHops() << "\n";
+
+        // Конвейер: каждое звено в своём потоке
+        RequestPipeline pipeline({ &k1, &k2, &k3 });
+        for (const ChainRequest& request : requests)
+            pipeline.Submit(request);
+        pipeline.Drain();
+        pipeline.Close();
+        std::size_t stage = 1;
+        for (const StageMetrics& metrics : pipeline.Metrics())
+            std::cout << "Stage " << stage++ << ": handled " << metrics.handled
+                << ", forwarded " << metrics.forwarded << ", peak depth " << metrics.peak_depth << "\n";
+    }
+
+    // Время запроса в цепочке из 3..1000 обработчиков: обход по порядку против
+    // скомпилированной таблицы, с плотными номерами видов и с разреженными
+    // (большие номера попадают в хеш-таблицу)
+    void benchmark_chain_lookup() {
+        constexpr int requests = 1000000;
+        auto measure = [](RequestChain& chain, const std::vector<ChainRequest>& load) {
+            std::size_t handled = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < requests; ++i)
+                handled += chain.HandleRequest(load[i % load.size()]);
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / requests;
+            if (handled != std::size_t(requests)) std::cout << "Часть запросов не обработана\n";
+            return ns;
+        };
+        for (std::uint32_t count : { 3u, 10u, 100u, 1000u }) {
+            std::vector<std::unique_ptr<NullHandler>> dense, sparse;
+            RequestChain traversed, compiled, hashed;
+            for (std::uint32_t i = 0; i < count; ++i) {
+                dense.push_back(std::make_unique<NullHandler>(std::initializer_list<std::uint32_t>{ i }));
+                sparse.push_back(std::make_unique<NullHandler>(std::initializer_list<std::uint32_t>{ i * 4000037u + 65536u }));
+                traversed.Add(dense.back().get());
+                compiled.Add(dense.back().get());
+                hashed.Add(sparse.back().get());
+            }
+            compiled.Compile();
+            hashed.Compile();
+            std::vector<ChainRequest> dense_load, sparse_load;
+            std::uint64_t seed = 88172645463325252ull;
+            for (int i = 0; i < 4096; ++i) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                std::uint32_t kind = std::uint32_t(seed % count);
+                dense_load.push_back({ kind, i });
+                sparse_load.push_back({ kind * 4000037u + 65536u, i });
+            }
+            std::cout << count << " обработчиков: обход " << measure(traversed, dense_load)
+                << " нс, таблица " << measure(compiled, dense_load)
+                << " нс, хеш-таблица " << measure(hashed, sparse_load) << " нс на запрос\n";
+        }
+    }
+
+    // Конвейер из 1..8 звеньев против обхода цепочки в вызывающем потоке. Каждый
+    // обработчик тратит около микросекунды на запрос, чтобы звенья было что распараллелить
+    void benchmark_chain_pipeline() {
+        class WorkHandler : public RequestHandler {
+        public:
+            explicit WorkHandler(std::uint32_t kind) : RequestHandler({ kind }) {}
+            void Handle(const ChainRequest& request) override {
+                double sum = 0;
+                for (int i = 0; i < 2000; ++i) sum += i * 0.5;
+                result = sum;
+                handled.fetch_add(request.payload, std::memory_order_relaxed);
+            }
+            std::atomic<std::int64_t> handled{ 0 };
+        private:
+            volatile double result = 0;
+        };
+
+        constexpr int requests = 40000;
+        for (std::uint32_t count : { 1u, 2u, 4u, 8u }) {
+            std::vector<std::unique_ptr<WorkHandler>> handlers;
+            std::vector<RequestHandler*> stages;
+            RequestChain chain;
+            for (std::uint32_t i = 0; i < count; ++i) {
+                handlers.push_back(std::make_unique<WorkHandler>(i));
+                stages.push_back(handlers.back().get());
+                chain.Add(handlers.back().get());
+            }
+            // Вид count не принимает никто: такие запросы проходят все звенья
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < requests; ++i)
+                chain.HandleRequest({ std::uint32_t(i % (count + 1)), 1 });
+            double sequential = requests / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 1e6;
+            std::int64_t chain_handled = 0;
+            for (auto& handler : handlers) chain_handled += handler->handled.exchange(0);
+
+            RequestPipeline pipeline(stages, 256);
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < requests; ++i)
+                pipeline.Submit({ std::uint32_t(i % (count + 1)), 1 });
+            pipeline.Drain();
+            double pipelined = requests / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 1e6;
+            std::int64_t pipeline_handled = 0;
+            for (auto& handler : handlers) pipeline_handled += handler->handled.load();
+            std::size_t peak = 0;
+            for (const StageMetrics& metrics : pipeline.Metrics()) peak = std::max(peak, metrics.peak_depth);
+            std::cout << count << " звеньев: цепочка " << sequential << " млн запросов в секунду, конвейер "
+                << pipelined << " млн запросов в секунду, наибольшая глубина очереди " << peak;
+            if (chain_handled != pipeline_handled) std::cout << ", обработано разное число запросов";
+            std::cout << "\n";
+        }
+    }
+
+    // Пакетная обработка: миллион случайных запросов пачками по 4096 против
+    // запросов по одному, в обходе по порядку и в скомпилированной цепочке
+    void benchmark_chain_batch() {
+        static constexpr std::size_t requests = 1000000, batch_size = 4096;
+        for (std::uint32_t count : { 3u, 16u, 100u }) {
+            std::vector<std::unique_ptr<NullHandler>> handlers;
+            RequestChain ordered, compiled;
+            for (std::uint32_t i = 0; i < count; ++i) {
+                handlers.push_back(std::make_unique<NullHandler>(std::initializer_list<std::uint32_t>{ i }));
+                ordered.Add(handlers.back().get());
+                compiled.Add(handlers.back().get());
+            }
+            compiled.Compile();
+            // Вид count не принимает никто
+            std::vector<ChainRequest> load(requests);
+            std::uint64_t seed = 88172645463325252ull;
+            for (std::size_t i = 0; i < requests; ++i) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                load[i] = { std::uint32_t(seed % (count + 1)), std::int64_t(i) };
+            }
+            std::size_t unhandled[4] = {};
+            auto single = [&load](RequestChain& chain, std::size_t& left) {
+                auto start = std::chrono::steady_clock::now();
+                for (const ChainRequest& request : load) left += !chain.HandleRequest(request);
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / requests;
+            };
+            auto batched = [&load](RequestChain& chain, std::size_t& left) {
+                auto start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < requests; i += batch_size)
+                    left += chain.HandleBatch(std::span<const ChainRequest>(load).subspan(i, std::min(batch_size, requests - i)));
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / requests;
+            };
+            double ordered_single = single(ordered, unhandled[0]);
+            double ordered_batch = batched(ordered, unhandled[1]);
+            double compiled_single = single(compiled, unhandled[2]);
+            double compiled_batch = batched(compiled, unhandled[3]);
+            std::cout << count << " обработчиков, нс на запрос: обход " << ordered_single << ", обход пачками "
+                << ordered_batch << ", таблица " << compiled_single << ", таблица пачками " << compiled_batch;
+            if (unhandled[1] != unhandled[0] || unhandled[2] != unhandled[0] || unhandled[3] != unhandled[0])
+                std::cout << ", режимы разошлись";
+            std::cout << "\n";
+        }
+    }
+
+    // Самонастройка на перекошенной нагрузке: виды запросов распределены по Ципфу
+    // (s = 1.1), причём самые частые обрабатывает конец цепочки. Неподвижный порядок -
+    // та же AdaptiveChain с периодом, который никогда не наступает
+    void benchmark_chain_adaptive() {
+        constexpr std::size_t requests = 2000000;
+        for (std::uint32_t count : { 8u, 32u, 128u }) {
+            std::vector<std::unique_ptr<NullHandler>> handlers;
+            AdaptiveChain fixed(std::uint64_t(-1)), adaptive(4096);
+            for (std::uint32_t i = 0; i < count; ++i) {
+                handlers.push_back(std::make_unique<NullHandler>(std::initializer_list<std::uint32_t>{ i }));
+                fixed.Add(handlers.back().get(), true);
+                adaptive.Add(handlers.back().get(), true);
+            }
+            std::vector<double> cdf(count);
+            double total = 0;
+            for (std::uint32_t i = 0; i < count; ++i) cdf[i] = total += 1.0 / std::pow(i + 1.0, 1.1);
+            std::vector<ChainRequest> load(requests);
+            std::uint64_t seed = 88172645463325252ull;
+            for (ChainRequest& request : load) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                double u = double(seed >> 11) / double(std::uint64_t(1) << 53) * total;
+                auto rank = std::uint32_t(std::lower_bound(cdf.begin(), cdf.end() - 1, u) - cdf.begin());
+                request = { count - 1 - rank, 0 };
+            }
+            auto measure = [&load](AdaptiveChain& chain) {
+                auto start = std::chrono::steady_clock::now();
+                for (const ChainRequest& request : load) chain.HandleRequest(request);
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / load.size();
+            };
+            double fixed_ns = measure(fixed), adaptive_ns = measure(adaptive);
+            std::cout << count << " обработчиков: неподвижный порядок " << fixed.AverageHops() << " шагов ("
+                << fixed_ns << " нс), самонастройка " << adaptive.AverageHops() << " шагов (" << adaptive_ns << " нс)\n";
+        }
+    }
+
+    void benchmark_chain() {
+        benchmark_chain_lookup();
+        benchmark_chain_batch();
+        benchmark_chain_adaptive();
+        benchmark_chain_pipeline();
     }
-}
\ No newline at end of file
+}
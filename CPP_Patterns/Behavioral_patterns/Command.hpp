@@ -8,6 +8,44 @@
 #include <string>
 #include <vector>
 #include <stack>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <concepts>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 // Концепция паттерна "Команда"
 namespace Сonception {
@@ -82,11 +120,23 @@ namespace Behavioral {
     };
 
     class Conveyor final {
+    private:
+        int speed = 0;
     public:
         void start() { cout << "Конвейер запущен!\n"; }
         void stop() { cout << "Конвейер остановлен!\n"; }
-        void speed_increase() { cout << "Скорость увеличена\n"; }
-        void speed_decrease() { cout << "Скорость снижена\n"; }
+        void speed_increase() { ++speed; cout << "Скорость увеличена\n"; }
+        void speed_decrease() { --speed; cout << "Скорость снижена\n"; }
+        // Изменение скорости сразу на несколько шагов - одно обращение к приводу
+        void speed_change(int steps) {
+            if (steps == 1) speed_increase();
+            else if (steps == -1) speed_decrease();
+            else if (steps != 0) {
+                speed += steps;
+                cout << "Скорость изменена на " << steps << " шаг(ов)\n";
+            }
+        }
+        int get_speed() const { return speed; }
     };
 
     class ConveyorCommand final : public ICommand {
@@ -98,45 +148,1293 @@ namespace Behavioral {
         void negative() override { conveyor->stop(); }
     };
 
+    // Изменение скорости на steps шагов (отрицательное значение - снижение).
+    // Соседние изменения скорости одного конвейера сливаются в одно с суммарным шагом.
     class ConveyorAdjust final : public ICommand {
     private:
         Conveyor* conveyor;
+        int steps;
     public:
-        ConveyorAdjust(Conveyor* con) : conveyor(con) {};
-        void positive() override { conveyor->speed_increase(); }
-        void negative() override { conveyor->speed_decrease(); }
+        ConveyorAdjust(Conveyor* con, int steps = 1) : conveyor(con), steps(steps) {};
+        void positive() override { conveyor->speed_change(steps); }
+        void negative() override { conveyor->speed_change(-steps); }
+        bool merge(const ConveyorAdjust& next) {
+            if (next.conveyor != conveyor) return false;
+            steps += next.steps;
+            return true;
+        }
+        bool idle() const { return steps == 0; }
     };
 
+    // Команда-значение: хранит любой объект с методами positive()/negative()
+    // во встроенном буфере (small buffer), без выделения памяти в куче.
+    // Вызовы идут через статическую таблицу операций конкретного типа,
+    // поэтому для final-классов они не требуют виртуальной диспетчеризации.
+    class PultCommand final {
+    private:
+        static constexpr std::size_t buffer_size = 4 * sizeof(void*);
+
+        using MergeFn = bool (*)(void*, const void*);
+        using IdleFn = bool (*)(const void*);
+
+        struct Operations {
+            void (*positive)(void*);
+            void (*negative)(void*);
+            void (*copy)(void*, const void*);
+            void (*move)(void*, void*);
+            void (*destroy)(void*);
+            MergeFn merge;  // nullptr, если тип не умеет сливаться
+            IdleFn idle;    // nullptr, если тип не бывает пустым
+        };
+
+        template <class T>
+        static constexpr MergeFn merge_for() {
+            if constexpr (requires(T& t, const T& next) { { t.merge(next) } -> std::convertible_to<bool>; })
+                return [](void* self, const void* next) { return static_cast<T*>(self)->merge(*static_cast<const T*>(next)); };
+            else
+                return nullptr;
+        }
+
+        template <class T>
+        static constexpr IdleFn idle_for() {
+            if constexpr (requires(const T& t) { { t.idle() } -> std::convertible_to<bool>; })
+                return [](const void* self) { return static_cast<const T*>(self)->idle(); };
+            else
+                return nullptr;
+        }
+
+        template <class T>
+        static constexpr Operations operations_for{
+            [](void* self) { static_cast<T*>(self)->positive(); },
+            [](void* self) { static_cast<T*>(self)->negative(); },
+            [](void* dst, const void* src) { ::new (dst) T(*static_cast<const T*>(src)); },
+            [](void* dst, void* src) {
+                ::new (dst) T(std::move(*static_cast<T*>(src)));
+                static_cast<T*>(src)->~T();
+            },
+            [](void* self) { static_cast<T*>(self)->~T(); },
+            merge_for<T>(),
+            idle_for<T>()
+        };
+
+        // Адаптер для команд, созданных по-старому через new и переданных как ICommand*
+        struct IndirectCommand {
+            ICommand* command;
+            void positive() { command->positive(); }
+            void negative() { command->negative(); }
+        };
+
+        alignas(std::max_align_t) unsigned char buffer[buffer_size];
+        const Operations* operations = nullptr;
+
+        void reset() {
+            if (operations) {
+                operations->destroy(buffer);
+                operations = nullptr;
+            }
+        }
+    public:
+        PultCommand() = default;
+        PultCommand(ICommand* command) : PultCommand(IndirectCommand{ command }) {}
+
+        template <class T>
+            requires (!std::is_same_v<std::remove_cvref_t<T>, PultCommand>)
+                && std::constructible_from<std::remove_cvref_t<T>, T>
+                && requires(std::remove_cvref_t<T>& t) { t.positive(); t.negative(); }
+        PultCommand(T&& command) {
+            using Stored = std::remove_cvref_t<T>;
+            static_assert(sizeof(Stored) <= buffer_size, "Команда не помещается во встроенный буфер");
+            static_assert(alignof(Stored) <= alignof(std::max_align_t), "Неподдерживаемое выравнивание команды");
+            static_assert(std::is_nothrow_move_constructible_v<Stored>, "Команда должна перемещаться без исключений");
+            ::new (static_cast<void*>(buffer)) Stored(std::forward<T>(command));
+            operations = &operations_for<Stored>;
+        }
+
+        PultCommand(const PultCommand& other) : operations(other.operations) {
+            if (operations) operations->copy(buffer, other.buffer);
+        }
+        PultCommand(PultCommand&& other) noexcept : operations(other.operations) {
+            if (operations) {
+                operations->move(buffer, other.buffer);
+                other.operations = nullptr;
+            }
+        }
+        PultCommand& operator=(const PultCommand& other) {
+            if (this != &other) {
+                reset();
+                if (other.operations) other.operations->copy(buffer, other.buffer);
+                operations = other.operations;
+            }
+            return *this;
+        }
+        PultCommand& operator=(PultCommand&& other) noexcept {
+            if (this != &other) {
+                reset();
+                if (other.operations) {
+                    other.operations->move(buffer, other.buffer);
+                    operations = other.operations;
+                    other.operations = nullptr;
+                }
+            }
+            return *this;
+        }
+        ~PultCommand() { reset(); }
+
+        explicit operator bool() const { return operations != nullptr; }
+        void positive() { operations->positive(buffer); }
+        void negative() { operations->negative(buffer); }
+
+        // Поглощает следующую команду того же типа, если она совместима с этой
+        bool merge(const PultCommand& next) {
+            return operations && operations == next.operations && operations->merge
+                && operations->merge(buffer, next.buffer);
+        }
+        // Команда, действие которой взаимно уничтожилось (например, +1 и -1 шаг)
+        bool idle() const {
+            return operations && operations->idle && operations->idle(buffer);
+        }
+    };
+
+    // Команда из пары действий "выполнить"/"отменить" (например, лямбд)
+    template <class Positive, class Negative>
+    struct ActionCommand {
+        Positive on;
+        Negative off;
+        void positive() { on(); }
+        void negative() { off(); }
+    };
+
+    template <class Positive, class Negative>
+    ActionCommand<Positive, Negative> make_command(Positive on, Negative off) {
+        return { std::move(on), std::move(off) };
+    }
+
+    // Пульт хранит команды и историю по значению: команда лежит во встроенном
+    // буфере PultCommand, а история - в векторе с заранее зарезервированной
+    // ёмкостью, поэтому нажатие не выделяет память, пока история в неё помещается.
     class MultiPult final {
     private:
-        vector<ICommand*> commands;
-        stack<ICommand*> history;
+        vector<PultCommand> commands;
+        vector<PultCommand> history;
     public:
-        MultiPult() { commands.resize(2); }
-        void set_command(int button, ICommand* command) {
-            commands[button] = command;
+        explicit MultiPult(std::size_t history_capacity = 1024) {
+            commands.resize(2);
+            history.reserve(history_capacity);
         }
+        void set_command(int button, PultCommand command) {
+            commands[button] = std::move(command);
+        }
+        // Команда выполняется сразу, а в истории сливается с предыдущей записью,
+        // если они совместимы: повторные нажатия одной кнопки регулировки дают одну
+        // запись с суммарным шагом, а взаимно уничтожившаяся запись удаляется.
+        // Отмена откатывает суммарное действие записи.
         void press_on(int button) {
-            commands[button]->positive();
-            history.push(commands[button]);
+            commands[button].positive();
+            if (!history.empty() && history.back().merge(commands[button])) {
+                if (history.back().idle()) history.pop_back();
+                return;
+            }
+            history.push_back(commands[button]);
+        }
+        // Нажатие серии кнопок: соседние совместимые команды сливаются в одну
+        // с суммарным действием ещё до выполнения, и в историю попадает одна
+        // запись на серию. Взаимно уничтожившиеся команды не выполняются вовсе.
+        // Отмена такой записи точно откатывает её суммарное действие.
+        void press_sequence(const vector<int>& buttons) {
+            PultCommand pending;
+            for (int button : buttons) {
+                if (pending.merge(commands[button])) continue;
+                flush(pending);
+                pending = commands[button];
+            }
+            flush(pending);
         }
         void press_cancel() {
             if (!history.empty()) {
-                history.top()->negative();
-                history.pop();
+                history.back().negative();
+                history.pop_back();
+            }
+        }
+        std::size_t history_size() const { return history.size(); }
+        std::size_t history_capacity() const { return history.capacity(); }
+        std::size_t button_count() const { return commands.size(); }
+    private:
+        void flush(PultCommand& command) {
+            if (!command || command.idle()) return;
+            command.positive();
+            history.push_back(std::move(command));
+            command = PultCommand();
+        }
+    };
+
+    // Планировщик отложенных и периодических команд на иерархическом колесе таймеров.
+    // Четыре уровня по 64 слота: уровень k покрывает 64^(k+1) тиков, поэтому при тике
+    // в 1 мс колесо охватывает ~4.6 часа (более дальние таймеры дожидаются на верхнем
+    // уровне). Таймеры лежат в пуле узлов и связаны в двусвязные списки слотов, так что
+    // постановка и отмена выполняются за O(1). Один поток-диспетчер продвигает колесо
+    // и выполняет наступившие команды вне блокировки.
+    class CommandScheduler final {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // Дескриптор таймера для отмены; поколение защищает от повторно занятых узлов.
+        // Поколение 0 не выдаётся, поэтому TimerId{} не совпадает ни с одним таймером.
+        struct TimerId {
+            std::uint32_t index = 0;
+            std::uint32_t generation = 0;
+        };
+    private:
+        static constexpr std::uint32_t none = 0xFFFFFFFF;
+        static constexpr unsigned slot_bits = 6;
+        static constexpr unsigned slots = 1u << slot_bits;
+        static constexpr unsigned levels = 4;
+        static constexpr std::uint64_t max_span = std::uint64_t(1) << (slot_bits * levels);
+
+        struct Timer {
+            PultCommand command;
+            std::uint64_t expires = 0;  // номер тика срабатывания
+            std::uint64_t period = 0;   // 0 - однократный таймер
+            std::uint32_t prev = none;
+            std::uint32_t next = none;
+            std::uint32_t slot = none;  // индекс слота в wheel, none - таймер свободен
+            std::uint32_t generation = 1;
+        };
+
+        clock::duration tick;
+        clock::time_point start;
+        std::uint64_t current = 0;  // последний обработанный тик
+        vector<Timer> timers;
+        vector<std::uint32_t> free_timers;
+        std::uint32_t wheel[levels * slots];
+        vector<PultCommand> due;
+
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        bool stopping = false;
+        std::thread dispatcher;
+
+        void link(std::uint32_t index) {
+            Timer& t = timers[index];
+            std::uint64_t delta = t.expires > current ? t.expires - current : 0;
+            std::uint64_t expires = delta < max_span ? t.expires : current + max_span - 1;
+            if (delta >= max_span) delta = max_span - 1;
+            unsigned level = 0;
+            while (delta >= (std::uint64_t(1) << (slot_bits * (level + 1)))) ++level;
+            std::uint32_t slot = level * slots + unsigned((expires >> (slot_bits * level)) & (slots - 1));
+            t.slot = slot;
+            t.prev = none;
+            t.next = wheel[slot];
+            if (t.next != none) timers[t.next].prev = index;
+            wheel[slot] = index;
+        }
+        void unlink(std::uint32_t index) {
+            Timer& t = timers[index];
+            if (t.prev != none) timers[t.prev].next = t.next;
+            else wheel[t.slot] = t.next;
+            if (t.next != none) timers[t.next].prev = t.prev;
+            t.slot = none;
+        }
+        void release(std::uint32_t index) {
+            timers[index].command = PultCommand();
+            if (++timers[index].generation == 0) timers[index].generation = 1;
+            free_timers.push_back(index);
+        }
+        // Переносит таймеры слота верхнего уровня на нижние уровни
+        void cascade(unsigned level) {
+            std::uint32_t slot = level * slots + unsigned((current >> (slot_bits * level)) & (slots - 1));
+            std::uint32_t index = wheel[slot];
+            wheel[slot] = none;
+            while (index != none) {
+                std::uint32_t next = timers[index].next;
+                link(index);
+                index = next;
+            }
+        }
+        // Продвигает колесо на один тик и собирает наступившие команды в due
+        void advance() {
+            ++current;
+            for (unsigned level = 1; level < levels; ++level) {
+                if ((current & ((std::uint64_t(1) << (slot_bits * level)) - 1)) != 0) break;
+                cascade(level);
             }
+            std::uint32_t index = wheel[current & (slots - 1)];
+            while (index != none) {
+                std::uint32_t next = timers[index].next;
+                Timer& t = timers[index];
+                unlink(index);
+                if (t.expires > current) {
+                    link(index);  // дальний таймер, временно прижатый к краю колеса
+                }
+                else if (t.period) {
+                    due.push_back(t.command);
+                    t.expires = current + t.period;
+                    link(index);
+                }
+                else {
+                    due.push_back(std::move(t.command));
+                    release(index);
+                }
+                index = next;
+            }
+        }
+        void run() {
+            vector<PultCommand> batch;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping) {
+                std::uint64_t now = std::uint64_t((clock::now() - start) / tick);
+                while (current < now) advance();
+                if (!due.empty()) {
+                    batch.swap(due);
+                    lock.unlock();
+                    for (PultCommand& command : batch) command.positive();
+                    batch.clear();
+                    lock.lock();
+                    continue;
+                }
+                wakeup.wait_until(lock, start + tick * (current + 1));
+            }
+        }
+        std::uint64_t ticks(clock::duration delay) const {
+            std::uint64_t count = delay > clock::duration::zero()
+                ? std::uint64_t((delay + tick - clock::duration(1)) / tick) : 0;
+            return count;
+        }
+    public:
+        explicit CommandScheduler(clock::duration tick = std::chrono::milliseconds(1))
+            : tick(tick), start(clock::now()) {
+            std::fill(std::begin(wheel), std::end(wheel), none);
+            dispatcher = std::thread([this] { run(); });
+        }
+        CommandScheduler(const CommandScheduler&) = delete;
+        CommandScheduler& operator=(const CommandScheduler&) = delete;
+        ~CommandScheduler() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeup.notify_one();
+            dispatcher.join();
+        }
+
+        // Однократное выполнение command.positive() через delay
+        TimerId schedule_after(clock::duration delay, PultCommand command) {
+            return schedule(delay, 0, std::move(command));
+        }
+        // Выполнение command.positive() каждые period, первый раз - через period
+        TimerId schedule_every(clock::duration period, PultCommand command) {
+            return schedule(period, std::max<std::uint64_t>(ticks(period), 1), std::move(command));
+        }
+        // Отмена таймера; false, если он уже сработал или был отменён
+        bool cancel(TimerId id) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (id.index >= timers.size()) return false;
+            Timer& t = timers[id.index];
+            if (t.generation != id.generation || t.slot == none) return false;
+            unlink(id.index);
+            release(id.index);
+            return true;
+        }
+    private:
+        TimerId schedule(clock::duration delay, std::uint64_t period, PultCommand command) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::uint32_t index;
+            if (free_timers.empty()) {
+                index = std::uint32_t(timers.size());
+                timers.emplace_back();
+            }
+            else {
+                index = free_timers.back();
+                free_timers.pop_back();
+            }
+            Timer& t = timers[index];
+            t.command = std::move(command);
+            // Отсчёт от текущего момента, даже если диспетчер ещё не догнал часы;
+            // лишний тик компенсирует округление вниз, чтобы таймер не сработал раньше срока
+            std::uint64_t now = std::max(current, std::uint64_t((clock::now() - start) / tick));
+            t.expires = now + 1 + ticks(delay);
+            t.period = period;
+            link(index);
+            return { index, t.generation };
         }
     };
 
+    // Сценарии команд на сопрограммах C++20: последовательность команд пишется
+    // линейным кодом (co_await start; co_await adjust;), а выполняет её один
+    // однопоточный цикл CommandLoop. Каждая co_await-команда ставится в очередь
+    // цикла, цикл выполняет её и возобновляет ожидающую сопрограмму, поэтому
+    // десятки тысяч сценариев чередуются в одном потоке, занимая лишь свои кадры.
+    class CommandLoop;
+
+    // Ожидание выполнения команды; живёт в кадре сопрограммы до её возобновления
+    struct CommandAwaiter {
+        CommandLoop* loop;
+        PultCommand command;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+    };
+
+    class CommandScript final {
+    public:
+        struct promise_type {
+            CommandLoop* loop = nullptr;
+
+            CommandScript get_return_object() {
+                return CommandScript(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            // Любая команда (ICommand& без копирования или значение) становится ожидаемой
+            CommandAwaiter await_transform(ICommand& command) {
+                return { loop, PultCommand(&command) };
+            }
+            CommandAwaiter await_transform(PultCommand command) {
+                return { loop, std::move(command) };
+            }
+        };
+
+        CommandScript(CommandScript&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        CommandScript(const CommandScript&) = delete;
+        CommandScript& operator=(const CommandScript&) = delete;
+        CommandScript& operator=(CommandScript&&) = delete;
+        ~CommandScript() { if (handle) handle.destroy(); }
+    private:
+        friend class CommandLoop;
+        explicit CommandScript(std::coroutine_handle<promise_type> h) : handle(h) {}
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    class CommandLoop final {
+    private:
+        struct Job {
+            CommandAwaiter* awaiter;  // nullptr - первый запуск сценария
+            std::coroutine_handle<> handle;
+        };
+        std::deque<Job> ready;
+        std::size_t active = 0;
+    public:
+        CommandLoop() = default;
+        CommandLoop(const CommandLoop&) = delete;
+        CommandLoop& operator=(const CommandLoop&) = delete;
+        ~CommandLoop() {
+            for (Job& job : ready) job.handle.destroy();
+        }
+
+        // Передаёт сценарий циклу; он начнёт выполняться при run()
+        void spawn(CommandScript script) {
+            auto handle = std::exchange(script.handle, nullptr);
+            handle.promise().loop = this;
+            ready.push_back({ nullptr, handle });
+            ++active;
+        }
+        void post(CommandAwaiter* awaiter, std::coroutine_handle<> handle) {
+            ready.push_back({ awaiter, handle });
+        }
+        // Выполняет команды и возобновляет сценарии, пока все они не завершатся
+        void run() {
+            while (!ready.empty()) {
+                Job job = ready.front();
+                ready.pop_front();
+                if (job.awaiter) job.awaiter->command.positive();
+                job.handle.resume();
+                if (job.handle.done()) {
+                    job.handle.destroy();
+                    --active;
+                }
+            }
+        }
+        std::size_t active_scripts() const { return active; }
+    };
+
+    inline void CommandAwaiter::await_suspend(std::coroutine_handle<> handle) {
+        loop->post(this, handle);
+    }
+
+    CommandScript conveyor_script(Conveyor* conveyor, int steps) {
+        ConveyorAdjust adjust(conveyor, steps);
+        co_await ConveyorCommand(conveyor);
+        co_await adjust;
+        co_await adjust;
+    }
+
+    // Пульт для одновременных нажатий из многих потоков.
+    // Кнопки разбиты на шарды: кнопки, чьи команды управляют одним получателем,
+    // должны находиться в одном шарде. Шардов по умолчанию столько же, сколько
+    // аппаратных потоков, но кнопка без явного номера шарда попадает в шард 0:
+    // разнести получателей по шардам можно только через set_command с номером шарда.
+    // Нажатия в разных шардах идут параллельно,
+    // внутри шарда - под его собственной блокировкой. Общая история - lock-free
+    // стек записей (стек Трайбера с тегом против ABA): порядок стека задаёт единый
+    // порядок для отмены и совпадает с порядком выполнения для каждого получателя,
+    // а команды разных шардов перестановочны. Записи берутся из пула блоков
+    // и переиспользуются после отмены. Команды назначаются до начала одновременной работы.
+    class ConcurrentMultiPult final {
+    private:
+        static constexpr std::uint32_t none = 0xFFFFFFFF;
+        static constexpr unsigned chunk_bits = 12;
+        static constexpr std::size_t chunk_size = std::size_t(1) << chunk_bits;
+        static constexpr std::size_t max_chunks = std::size_t(1) << 12;
+
+        struct Entry {
+            std::atomic<std::uint32_t> next{ none };  // следующий в истории или в списке свободных
+            std::atomic<std::uint32_t> button{ 0 };
+            PultCommand command;
+        };
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+        };
+
+        vector<PultCommand> commands;
+        vector<std::size_t> shard_of;
+        std::unique_ptr<Shard[]> shards;
+        std::size_t shard_count;
+
+        // Пул записей растёт блоками, которые никогда не перемещаются
+        std::unique_ptr<std::atomic<Entry*>[]> chunks;
+        std::mutex chunk_mutex;
+        std::atomic<std::uint32_t> allocated{ 0 };
+
+        // Вершины стеков: [тег:32][индекс записи:32]
+        alignas(64) std::atomic<std::uint64_t> history{ pack(none, 0) };
+        alignas(64) std::atomic<std::uint64_t> free_entries{ pack(none, 0) };
+
+        static std::uint64_t pack(std::uint32_t index, std::uint32_t tag) {
+            return (std::uint64_t(tag) << 32) | index;
+        }
+        static std::uint32_t index_of(std::uint64_t top) { return std::uint32_t(top); }
+        static std::uint32_t tag_of(std::uint64_t top) { return std::uint32_t(top >> 32); }
+
+        Entry& entry(std::uint32_t index) {
+            std::size_t chunk = index >> chunk_bits;
+            Entry* block = chunks[chunk].load(std::memory_order_acquire);
+            if (!block) {
+                std::lock_guard<std::mutex> lock(chunk_mutex);
+                block = chunks[chunk].load(std::memory_order_relaxed);
+                if (!block) {
+                    block = new Entry[chunk_size];
+                    chunks[chunk].store(block, std::memory_order_release);
+                }
+            }
+            return block[index & (chunk_size - 1)];
+        }
+        void push(std::atomic<std::uint64_t>& stack, std::uint32_t index) {
+            std::uint64_t top = stack.load(std::memory_order_relaxed);
+            do {
+                entry(index).next.store(index_of(top), std::memory_order_relaxed);
+            } while (!stack.compare_exchange_weak(top, pack(index, tag_of(top) + 1),
+                std::memory_order_release, std::memory_order_relaxed));
+        }
+        std::uint32_t allocate() {
+            std::uint64_t top = free_entries.load(std::memory_order_acquire);
+            while (index_of(top) != none) {
+                std::uint32_t next = entry(index_of(top)).next.load(std::memory_order_relaxed);
+                if (free_entries.compare_exchange_weak(top, pack(next, tag_of(top) + 1),
+                    std::memory_order_acquire, std::memory_order_acquire))
+                    return index_of(top);
+            }
+            std::uint32_t index = allocated.fetch_add(1, std::memory_order_relaxed);
+            if (index >= chunk_size * max_chunks) throw std::length_error("ConcurrentMultiPult history is full");
+            return index;
+        }
+        static std::size_t default_shard_count() {
+            return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+        }
+    public:
+        explicit ConcurrentMultiPult(std::size_t buttons = 2, std::size_t shard_count = default_shard_count())
+            : commands(buttons), shard_of(buttons), shards(new Shard[std::max<std::size_t>(1, shard_count)]),
+              shard_count(std::max<std::size_t>(1, shard_count)), chunks(new std::atomic<Entry*>[max_chunks]) {
+            for (std::size_t i = 0; i < max_chunks; ++i) chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+        ConcurrentMultiPult(const ConcurrentMultiPult&) = delete;
+        ConcurrentMultiPult& operator=(const ConcurrentMultiPult&) = delete;
+        ~ConcurrentMultiPult() {
+            for (std::size_t i = 0; i < max_chunks; ++i) delete[] chunks[i].load(std::memory_order_relaxed);
+        }
+
+        void set_command(int button, PultCommand command, std::size_t shard) {
+            commands[button] = std::move(command);
+            shard_of[button] = shard % shard_count;
+        }
+        // Кнопка остаётся в своём шарде (изначально - в шарде 0)
+        void set_command(int button, PultCommand command) {
+            commands[button] = std::move(command);
+        }
+
+        void press_on(int button) {
+            std::lock_guard<std::mutex> lock(shards[shard_of[button]].mutex);
+            std::uint32_t index = allocate();
+            Entry& e = entry(index);
+            e.button.store(std::uint32_t(button), std::memory_order_relaxed);
+            e.command = commands[button];
+            e.command.positive();
+            push(history, index);
+        }
+        // Отменяет последнюю выполненную команду; false - отменять нечего
+        bool press_cancel() {
+            while (true) {
+                std::uint64_t top = history.load(std::memory_order_acquire);
+                if (index_of(top) == none) return false;
+                Entry& e = entry(index_of(top));
+                std::uint32_t button = e.button.load(std::memory_order_relaxed);
+                // Блокировка шарда не даёт новым нажатиям того же получателя
+                // вклиниться между снятием записи и откатом её команды
+                std::lock_guard<std::mutex> lock(shards[shard_of[button]].mutex);
+                std::uint32_t next = e.next.load(std::memory_order_relaxed);
+                if (!history.compare_exchange_strong(top, pack(next, tag_of(top) + 1),
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                    continue;
+                e.command.negative();
+                e.command = PultCommand();
+                push(free_entries, index_of(top));
+                return true;
+            }
+        }
+    };
+
+    // Локальный потоковый сокет Unix (AF_UNIX). На Windows 10+ тот же API
+    // предоставляет Winsock через afunix.h.
+    class UnixSocket final {
+    private:
+#ifdef _WIN32
+        using native_handle = SOCKET;
+        static constexpr native_handle invalid = INVALID_SOCKET;
+        static void close_handle(native_handle h) { closesocket(h); }
+        static void startup() {
+            static const bool started = [] {
+                WSADATA data;
+                return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+            }();
+            if (!started) throw std::runtime_error("WSAStartup failed");
+        }
+#else
+        using native_handle = int;
+        static constexpr native_handle invalid = -1;
+        static void close_handle(native_handle h) { ::close(h); }
+        static void startup() {}
+#endif
+        native_handle handle = invalid;
+
+        explicit UnixSocket(native_handle h) : handle(h) {}
+
+        static sockaddr_un address(const std::string& path) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path))
+                throw std::runtime_error("Unix socket path is too long: " + path);
+            std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+            return addr;
+        }
+        static native_handle open() {
+            startup();
+            native_handle h = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (h == invalid) throw std::runtime_error("socket(AF_UNIX) failed");
+            return h;
+        }
+    public:
+        UnixSocket() = default;
+        UnixSocket(UnixSocket&& other) noexcept : handle(std::exchange(other.handle, invalid)) {}
+        UnixSocket& operator=(UnixSocket&& other) noexcept {
+            if (this != &other) {
+                close();
+                handle = std::exchange(other.handle, invalid);
+            }
+            return *this;
+        }
+        ~UnixSocket() { close(); }
+
+        static UnixSocket listen(const std::string& path) {
+            UnixSocket socket(open());
+            sockaddr_un addr = address(path);
+            std::remove(path.c_str());
+            if (::bind(socket.handle, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+                || ::listen(socket.handle, 1) != 0)
+                throw std::runtime_error("Unable to listen on " + path);
+            return socket;
+        }
+        static UnixSocket connect(const std::string& path) {
+            UnixSocket socket(open());
+            sockaddr_un addr = address(path);
+            if (::connect(socket.handle, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+                throw std::runtime_error("Unable to connect to " + path);
+            return socket;
+        }
+        UnixSocket accept() {
+            native_handle h = ::accept(handle, nullptr, nullptr);
+            if (h == invalid) throw std::runtime_error("accept() failed");
+            return UnixSocket(h);
+        }
+        void close() {
+            if (handle != invalid) close_handle(std::exchange(handle, invalid));
+        }
+
+        void send_all(const void* data, std::size_t size) {
+            const char* bytes = static_cast<const char*>(data);
+            while (size) {
+#ifdef MSG_NOSIGNAL
+                auto sent = ::send(handle, bytes, int(size), MSG_NOSIGNAL);
+#else
+                auto sent = ::send(handle, bytes, int(size), 0);
+#endif
+                if (sent <= 0) throw std::runtime_error("send() failed");
+                bytes += sent;
+                size -= std::size_t(sent);
+            }
+        }
+        // false - соединение закрыто до начала сообщения
+        bool receive_all(void* data, std::size_t size) {
+            char* bytes = static_cast<char*>(data);
+            std::size_t received = 0;
+            while (received < size) {
+                auto count = ::recv(handle, bytes + received, int(size - received), 0);
+                if (count == 0 && received == 0) return false;
+                if (count <= 0) throw std::runtime_error("recv() failed");
+                received += std::size_t(count);
+            }
+            return true;
+        }
+        // Есть ли данные для чтения без ожидания
+        bool readable() {
+#ifdef _WIN32
+            WSAPOLLFD fd{ handle, POLLRDNORM, 0 };
+            return WSAPoll(&fd, 1, 0) > 0;
+#else
+            pollfd fd{ handle, POLLIN, 0 };
+            return ::poll(&fd, 1, 0) > 0;
+#endif
+        }
+    };
+
+    // Репликация потока команд пульта на резервный процесс.
+    // Ведущий выполняет нажатие на своём пульте, сериализует его вместе с номером
+    // в последовательности и отправляет пачками по локальному сокету. Резервный
+    // применяет записи строго по порядку к своему пульту и подтверждает номер
+    // последней применённой записи. Кадр: [u32 длина][записи], запись:
+    // [u64 номер][u8 операция][u32 число кнопок][i32 кнопки...]. Порядок байт
+    // родной - обе стороны работают на одной машине.
+    // Передаются номера нажатых кнопок, а не сами команды, и set_command не
+    // реплицируется: резервный пульт должен быть заранее настроен теми же
+    // командами на тех же кнопках, иначе он повторит другую историю.
+    enum class PultOperation : std::uint8_t { PressOn, PressSequence, PressCancel };
+
+    // Предел длины кадра: реплика не выделяет под кадр больше, чем допускает
+    // протокол, даже если длина в заголовке повреждена
+    constexpr std::size_t max_replication_frame = std::size_t(1) << 20;
+    // Номер, операция и число кнопок
+    constexpr std::size_t replication_record_header = sizeof(std::uint64_t) + sizeof(std::uint8_t) + sizeof(std::uint32_t);
+
+    class ReplicatedPult final {
+    private:
+        MultiPult* pult;
+        UnixSocket socket;
+        std::size_t batch_size;
+        std::size_t batched = 0;
+        vector<char> batch;
+        std::uint64_t sequence = 0;
+        std::uint64_t acknowledged = 0;
+
+        template <class T>
+        void put(const T& value) {
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            batch.insert(batch.end(), bytes, bytes + sizeof(T));
+        }
+        static std::size_t record_size(std::size_t count) {
+            return replication_record_header + count * sizeof(std::int32_t);
+        }
+        void record(PultOperation operation, const int* buttons, std::uint32_t count) {
+            // Запись не помещается в текущий кадр - отправляем его раньше срока
+            if (batched && batch.size() - sizeof(std::uint32_t) + record_size(count) > max_replication_frame)
+                flush();
+            if (batch.empty()) batch.resize(sizeof(std::uint32_t));  // место под длину кадра
+            put(++sequence);
+            put(std::uint8_t(operation));
+            put(count);
+            for (std::uint32_t i = 0; i < count; ++i) put(std::int32_t(buttons[i]));
+            if (++batched >= batch_size) flush();
+        }
+        void read_acks(bool wait) {
+            while (acknowledged < sequence && (wait || socket.readable())) {
+                std::uint64_t ack;
+                if (!socket.receive_all(&ack, sizeof(ack)))
+                    throw std::runtime_error("Replica closed the connection");
+                acknowledged = ack;
+            }
+        }
+    public:
+        ReplicatedPult(MultiPult* pult, UnixSocket replica, std::size_t batch_size = 64)
+            : pult(pult), socket(std::move(replica)), batch_size(batch_size) {}
+        // Недоотправленная пачка уходит реплике до закрытия сокета
+        ~ReplicatedPult() {
+            try { sync(); }
+            catch (const std::exception&) {}
+        }
+        ReplicatedPult(const ReplicatedPult&) = delete;
+        ReplicatedPult& operator=(const ReplicatedPult&) = delete;
+
+        void press_on(int button) {
+            pult->press_on(button);
+            record(PultOperation::PressOn, &button, 1);
+        }
+        void press_sequence(const vector<int>& buttons) {
+            if (record_size(buttons.size()) > max_replication_frame)
+                throw std::length_error("Sequence does not fit into a replication frame");
+            pult->press_sequence(buttons);
+            record(PultOperation::PressSequence, buttons.data(), std::uint32_t(buttons.size()));
+        }
+        void press_cancel() {
+            pult->press_cancel();
+            record(PultOperation::PressCancel, nullptr, 0);
+        }
+        // Отправляет накопленную пачку и забирает пришедшие подтверждения
+        void flush() {
+            if (batched) {
+                std::uint32_t size = std::uint32_t(batch.size() - sizeof(std::uint32_t));
+                std::memcpy(batch.data(), &size, sizeof(size));
+                socket.send_all(batch.data(), batch.size());
+                batch.clear();
+                batched = 0;
+            }
+            read_acks(false);
+        }
+        // Дожидается, пока реплика применит все отправленные команды
+        void sync() {
+            flush();
+            read_acks(true);
+        }
+        std::uint64_t last_sequence() const { return sequence; }
+        std::uint64_t last_acknowledged() const { return acknowledged; }
+        // Отставание реплики в командах
+        std::uint64_t lag() const { return sequence - acknowledged; }
+    };
+
+    class PultReplica final {
+    private:
+        MultiPult* pult;
+        UnixSocket socket;
+        std::uint64_t applied = 0;
+
+        template <class T>
+        static T get(const char*& cursor) {
+            T value;
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return value;
+        }
+    public:
+        PultReplica(MultiPult* pult, UnixSocket primary) : pult(pult), socket(std::move(primary)) {}
+
+        // Применяет кадры ведущего, пока он не закроет соединение
+        void serve() {
+            vector<char> frame;
+            vector<int> buttons;
+            std::uint32_t size;
+            while (socket.receive_all(&size, sizeof(size))) {
+                if (size > max_replication_frame) {
+                    socket.close();
+                    throw std::runtime_error("Replication frame is too large");
+                }
+                frame.resize(size);
+                if (!socket.receive_all(frame.data(), size))
+                    throw std::runtime_error("Primary closed the connection mid-frame");
+                const char* cursor = frame.data();
+                const char* end = cursor + size;
+                while (cursor < end) {
+                    if (std::size_t(end - cursor) < replication_record_header)
+                        throw std::runtime_error("Malformed replication frame");
+                    auto sequence = get<std::uint64_t>(cursor);
+                    auto operation = PultOperation(get<std::uint8_t>(cursor));
+                    auto count = get<std::uint32_t>(cursor);
+                    if (count > std::size_t(end - cursor) / sizeof(std::int32_t))
+                        throw std::runtime_error("Malformed replication frame");
+                    buttons.resize(count);
+                    for (auto& button : buttons) {
+                        button = get<std::int32_t>(cursor);
+                        if (button < 0 || std::size_t(button) >= pult->button_count())
+                            throw std::runtime_error("Replicated button is out of range");
+                    }
+                    if (sequence != applied + 1)
+                        throw std::runtime_error("Replication stream is out of order");
+                    switch (operation) {
+                    case PultOperation::PressOn:       pult->press_on(buttons.at(0));  break;
+                    case PultOperation::PressSequence: pult->press_sequence(buttons);  break;
+                    case PultOperation::PressCancel:   pult->press_cancel();           break;
+                    default: throw std::runtime_error("Unknown replicated operation");
+                    }
+                    applied = sequence;
+                }
+                socket.send_all(&applied, sizeof(applied));
+            }
+        }
+        std::uint64_t last_applied() const { return applied; }
+    };
+
     void test_command() {
         Conveyor* conveyor = new Conveyor();
         MultiPult* pult = new MultiPult();
 
-        pult->set_command(0, new ConveyorCommand(conveyor));
-        pult->set_command(1, new ConveyorAdjust(conveyor));
+        pult->set_command(0, ConveyorCommand(conveyor));
+        pult->set_command(1, ConveyorAdjust(conveyor));
         pult->press_on(0);
         pult->press_on(1);
         pult->press_cancel();
         pult->press_cancel();
+
+        pult->set_command(1, ConveyorAdjust(conveyor, -1));
+        pult->set_command(0, ConveyorAdjust(conveyor));
+        pult->press_sequence({ 0, 0, 0, 1, 0, 0, 0 });  // одна команда: +5 шагов
+        pult->press_sequence({ 0, 1 });                 // взаимно уничтожились
+        pult->press_cancel();                           // точно откатывает -5 шагов
+
+        // Отдельные нажатия одной кнопки сливаются в истории в одну запись
+        pult->set_command(0, ConveyorAdjust(conveyor));
+        pult->press_on(0);
+        pult->press_on(0);
+        pult->press_on(0);
+        cout << "Записей в истории: " << pult->history_size() << "\n";   // 1
+        pult->press_cancel();                                              // -3 шага разом
+        cout << "Скорость после отмены: " << conveyor->get_speed() << ", записей в истории: "
+            << pult->history_size() << "\n";                                // 0, 0
+        pult->press_on(0);
+        pult->press_on(1);                                                 // +1 и -1 уничтожились
+        cout << "Записей в истории: " << pult->history_size() << "\n";   // 0
+
+        // Разгон каждые 10 мс и остановка через 35 мс
+        CommandScheduler scheduler;
+        auto ramp = scheduler.schedule_every(std::chrono::milliseconds(10), ConveyorAdjust(conveyor));
+        scheduler.schedule_after(std::chrono::milliseconds(35), make_command(
+            [conveyor] { conveyor->stop(); }, [conveyor] { conveyor->start(); }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        scheduler.cancel(ramp);
+
+        // Два сценария чередуются в одном потоке цикла
+        CommandLoop loop;
+        loop.spawn(conveyor_script(conveyor, 1));
+        loop.spawn(conveyor_script(conveyor, -1));
+        loop.run();
+
+        // Два потока нажимают кнопки разных конвейеров на одном пульте
+        Conveyor second;
+        ConcurrentMultiPult shared(2, 2);
+        shared.set_command(0, ConveyorAdjust(conveyor), 0);
+        shared.set_command(1, ConveyorAdjust(&second), 1);
+        std::thread left([&shared] { shared.press_on(0); });
+        std::thread right([&shared] { shared.press_on(1); });
+        left.join();
+        right.join();
+        while (shared.press_cancel()) {}
+
+        // Резервный пульт в отдельном потоке повторяет команды ведущего
+        std::string path = (std::filesystem::temp_directory_path() / "multipult.sock").string();
+        try {
+            UnixSocket listener = UnixSocket::listen(path);
+            UnixSocket to_replica = UnixSocket::connect(path);
+            UnixSocket to_primary = listener.accept();
+            std::thread standby([&to_primary] {
+                Conveyor mirror;
+                MultiPult replica_pult;
+                replica_pult.set_command(0, ConveyorCommand(&mirror));
+                replica_pult.set_command(1, ConveyorAdjust(&mirror));
+                PultReplica replica(&replica_pult, std::move(to_primary));
+                try { replica.serve(); }
+                catch (const std::exception& e) { cout << "Реплика остановлена: " << e.what() << "\n"; }
+            });
+            {
+                ReplicatedPult primary(pult, std::move(to_replica), 2);
+                pult->set_command(0, ConveyorCommand(conveyor));
+                pult->set_command(1, ConveyorAdjust(conveyor));
+                primary.press_on(0);
+                primary.press_sequence({ 1, 1 });
+                primary.press_cancel();
+                primary.sync();
+                cout << "Реплика подтвердила " << primary.last_acknowledged() << " команд(ы)\n";
+            }
+            standby.join();
+        }
+        catch (const std::exception& e) {
+            cout << "Репликация недоступна: " << e.what() << "\n";
+        }
+        std::remove(path.c_str());
+    }
+
+    // Замеры производительности
+    //--------------------------------------------------------------
+
+    // Команда прежнего образца (создаётся через new, хранится как ICommand*),
+    // считающая свои выделения памяти
+    class CountedCommand final : public ICommand {
+    private:
+        long* counter;
+    public:
+        static inline std::size_t allocations = 0;
+        explicit CountedCommand(long* counter) : counter(counter) {}
+        void positive() override { ++*counter; }
+        void negative() override { --*counter; }
+        static void* operator new(std::size_t size) { ++allocations; return ::operator new(size); }
+        static void operator delete(void* pointer) { ::operator delete(pointer); }
+    };
+
+    // Распределитель, считающий обращения контейнера к куче
+    template <class T>
+    struct CountingAllocator {
+        using value_type = T;
+        std::size_t* count;
+        explicit CountingAllocator(std::size_t* count) : count(count) {}
+        template <class U>
+        CountingAllocator(const CountingAllocator<U>& other) : count(other.count) {}
+        T* allocate(std::size_t n) { ++*count; return std::allocator<T>().allocate(n); }
+        void deallocate(T* pointer, std::size_t n) { std::allocator<T>().deallocate(pointer, n); }
+        template <class U>
+        bool operator==(const CountingAllocator<U>& other) const { return count == other.count; }
+    };
+
+    inline double elapsed_ns(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // Нажатие с новой командой на каждое нажатие и отмена всей серии:
+    // прежняя схема (new + ICommand* + stack на deque) против PultCommand и MultiPult
+    void benchmark_pult_press() {
+        constexpr int rounds = 2000, presses = 1000;
+        long counter = 0;
+
+        std::size_t history_allocations = 0;
+        CountedCommand::allocations = 0;
+        {
+            using History = std::deque<ICommand*, CountingAllocator<ICommand*>>;
+            stack<ICommand*, History> history{ History(CountingAllocator<ICommand*>(&history_allocations)) };
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                for (int i = 0; i < presses; ++i) {
+                    ICommand* command = new CountedCommand(&counter);
+                    command->positive();
+                    history.push(command);
+                }
+                while (!history.empty()) {
+                    history.top()->negative();
+                    delete history.top();
+                    history.pop();
+                }
+            }
+            double ns = elapsed_ns(start) / (double(rounds) * presses);
+            cout << "ICommand* + new: " << ns << " нс на нажатие и отмену, выделений памяти: "
+                << CountedCommand::allocations + history_allocations << " на "
+                << rounds * presses << " нажатий\n";
+        }
+        {
+            MultiPult pult(presses);
+            std::size_t capacity = pult.history_capacity();
+            std::size_t growths = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                for (int i = 0; i < presses; ++i) {
+                    pult.set_command(0, make_command([&counter] { ++counter; }, [&counter] { --counter; }));
+                    pult.press_on(0);
+                }
+                for (int i = 0; i < presses; ++i) pult.press_cancel();
+                if (pult.history_capacity() != capacity) {
+                    capacity = pult.history_capacity();
+                    ++growths;
+                }
+            }
+            double ns = elapsed_ns(start) / (double(rounds) * presses);
+            // Команда не может занять кучу: размер проверяется static_assert в PultCommand
+            cout << "PultCommand: " << ns << " нс на нажатие и отмену, выделений памяти: "
+                << growths << " на " << rounds * presses << " нажатий\n";
+        }
+        if (counter != 0) cout << "Счётчик не вернулся к нулю: " << counter << "\n";
+    }
+
+    // Стоимость постановки и отмены при миллионе ожидающих таймеров и
+    // точность срабатывания (отставание от срока) контрольных таймеров на их фоне
+    void benchmark_scheduler() {
+        using std::chrono::steady_clock;
+        constexpr std::size_t pending = 1000000, probes = 2000;
+        struct Probe {
+            steady_clock::time_point due;
+            steady_clock::time_point fired;
+        };
+        vector<Probe> probe(probes);
+        std::atomic<std::size_t> fired{ 0 };
+        std::atomic<std::size_t> fired_far{ 0 };
+
+        CommandScheduler scheduler;
+        vector<CommandScheduler::TimerId> ids;
+        ids.reserve(pending);
+        auto start = steady_clock::now();
+        for (std::size_t i = 0; i < pending; ++i)
+            ids.push_back(scheduler.schedule_after(std::chrono::seconds(60) + std::chrono::milliseconds(i % 60000),
+                make_command([&fired_far] { fired_far.fetch_add(1); }, [] {})));
+        double schedule_ns = elapsed_ns(start) / pending;
+
+        for (std::size_t i = 0; i < probes; ++i) {
+            auto delay = std::chrono::milliseconds(1 + i % 1000);
+            Probe* p = &probe[i];
+            p->due = steady_clock::now() + delay;
+            scheduler.schedule_after(delay, make_command([p, &fired] {
+                p->fired = steady_clock::now();
+                fired.fetch_add(1, std::memory_order_release);
+            }, [] {}));
+        }
+        while (fired.load(std::memory_order_acquire) < probes)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        start = steady_clock::now();
+        std::size_t cancelled = 0;
+        for (CommandScheduler::TimerId id : ids) cancelled += scheduler.cancel(id);
+        double cancel_ns = elapsed_ns(start) / pending;
+
+        vector<double> lateness;
+        std::size_t early = 0;
+        for (const Probe& p : probe) {
+            if (p.fired < p.due) ++early;
+            lateness.push_back(std::chrono::duration<double, std::micro>(p.fired - p.due).count());
+        }
+        std::sort(lateness.begin(), lateness.end());
+        cout << "Таймеры: постановка " << schedule_ns << " нс, отмена " << cancel_ns << " нс при "
+            << pending << " ожидающих (отменено " << cancelled << ", дальних сработало " << fired_far << ")\n";
+        cout << "Отставание срабатывания: p50 " << lateness[probes / 2] << " мкс, p99 "
+            << lateness[probes * 99 / 100] << " мкс, max " << lateness.back() << " мкс, досрочных " << early << "\n";
+    }
+
+    // Конкуренция от 1 до 32 потоков: у каждого потока свой получатель в своём
+    // шарде, каждое четвёртое действие - отмена. Сравнение с MultiPult под одним
+    // общим мьютексом.
+    void benchmark_concurrent_pult() {
+        constexpr std::size_t actions = 1 << 20;  // на замер, делятся между потоками
+        struct alignas(64) Receiver {
+            long state = 0;
+        };
+        for (std::size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+            std::size_t per_thread = actions / threads;
+            vector<Receiver> receivers(threads);
+
+            // По шарду на поток: каждый поток жмёт кнопку своего получателя
+            ConcurrentMultiPult sharded(threads, threads);
+            for (std::size_t t = 0; t < threads; ++t) {
+                long* state = &receivers[t].state;
+                sharded.set_command(int(t), make_command([state] { ++*state; }, [state] { --*state; }), t);
+            }
+            auto run = [&](auto&& body) {
+                vector<std::thread> workers;
+                auto start = std::chrono::steady_clock::now();
+                for (std::size_t t = 0; t < threads; ++t)
+                    workers.emplace_back([&body, t, per_thread] {
+                        for (std::size_t i = 0; i < per_thread; ++i) body(t, i % 4 == 3);
+                    });
+                for (std::thread& worker : workers) worker.join();
+                return double(per_thread * threads) / (elapsed_ns(start) / 1e9) / 1e6;
+            };
+            double sharded_rate = run([&sharded](std::size_t t, bool cancel) {
+                if (cancel) sharded.press_cancel();
+                else sharded.press_on(int(t));
+            });
+            while (sharded.press_cancel()) {}
+
+            long shared_state = 0;
+            MultiPult pult(actions);
+            pult.set_command(0, make_command([&shared_state] { ++shared_state; }, [&shared_state] { --shared_state; }));
+            pult.set_command(1, make_command([&shared_state] { shared_state += 2; }, [&shared_state] { shared_state -= 2; }));
+            std::mutex global;
+            double global_rate = run([&](std::size_t t, bool cancel) {
+                std::lock_guard<std::mutex> lock(global);
+                if (cancel) pult.press_cancel();
+                else pult.press_on(int(t & 1));
+            });
+
+            long residual = 0;
+            for (const Receiver& receiver : receivers) residual += receiver.state;
+            cout << "Потоков " << threads << ": шарды " << sharded_rate << " млн действий/с, общий мьютекс "
+                << global_rate << " млн действий/с, остаток после отмены " << residual << "\n";
+        }
+    }
+
+    // Одинаковая настройка кнопок ведущего и резервного пультов для замера репликации
+    inline void configure_replicated_pult(MultiPult& pult, long& state) {
+        pult.set_command(0, make_command([&state] { state += 1; }, [&state] { state -= 1; }));
+        pult.set_command(1, make_command([&state] { state += 2; }, [&state] { state -= 2; }));
+    }
+
+    // Резервный процесс: запускается как "Program --pult-replica <путь сокета>"
+    inline int run_pult_replica(const std::string& path) {
+        try {
+            long state = 0;
+            MultiPult pult;
+            configure_replicated_pult(pult, state);
+            UnixSocket listener = UnixSocket::listen(path);
+            PultReplica replica(&pult, listener.accept());
+            replica.serve();
+            cout << "Резервный процесс применил " << replica.last_applied() << " команд, состояние " << state << "\n";
+            return 0;
+        }
+        catch (const std::exception& e) {
+            cout << "Резервный процесс остановлен: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // Репликация на отдельный процесс: self - путь к исполняемому файлу программы,
+    // который запускается повторно в роли резервного
+    void benchmark_replication(const std::string& self) {
+        constexpr std::uint64_t operations = 1000000;
+        std::string path = (std::filesystem::temp_directory_path() / "multipult-bench.sock").string();
+        std::remove(path.c_str());
+#ifdef _WIN32
+        std::string command = "start \"\" /b \"" + self + "\" --pult-replica \"" + path + "\"";
+#else
+        std::string command = "\"" + self + "\" --pult-replica \"" + path + "\" &";
+#endif
+        try {
+            if (std::system(command.c_str()) != 0)
+                throw std::runtime_error("Unable to start the replica process");
+            UnixSocket socket;
+            for (int attempt = 0;; ++attempt) {
+                try {
+                    socket = UnixSocket::connect(path);
+                    break;
+                }
+                catch (const std::runtime_error&) {
+                    if (attempt == 100) throw;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+            }
+            long state = 0;
+            MultiPult pult;
+            configure_replicated_pult(pult, state);
+            ReplicatedPult primary(&pult, std::move(socket));
+            std::uint64_t max_lag = 0, lag_sum = 0, samples = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (std::uint64_t i = 0; i < operations; ++i) {
+                if (i % 8 == 7) primary.press_cancel();
+                else if (i % 16 == 5) primary.press_sequence({ 0, 1, 0 });
+                else primary.press_on(int(i & 1));
+                if (i % 1024 == 0) {
+                    std::uint64_t lag = primary.lag();
+                    max_lag = std::max(max_lag, lag);
+                    lag_sum += lag;
+                    ++samples;
+                }
+            }
+            primary.sync();
+            double seconds = elapsed_ns(start) / 1e9;
+            cout << "Репликация: " << operations / seconds << " команд/с, отставание в среднем "
+                << double(lag_sum) / double(samples) << ", максимум " << max_lag
+                << " команд, состояние ведущего " << state << "\n";
+        }
+        catch (const std::exception& e) {
+            cout << "Репликация недоступна: " << e.what() << "\n";
+        }
+        // Резервный процесс завершается, увидев закрытие соединения
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::remove(path.c_str());
+    }
+
+    void benchmark_command(const std::string& self) {
+        benchmark_pult_press();
+        benchmark_scheduler();
+        benchmark_concurrent_pult();
+        benchmark_replication(self);
     }
 }
\ No newline at end of file
@@ -9,6 +9,20 @@
 #pragma once
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 //--------------------------------------------------------------
 // Концепция и Реализация паттерна "Посредник"
@@ -78,6 +92,286 @@ namespace Behavioral {
         }
     };
 
+    // Посредник с маршрутизацией по темам
+    //--------------------------------------------------------------
+    // Участники регистрируются у посредника и подписываются на темы. Посредник
+    // хранит для каждой темы список подписчиков в хеш-таблице, поэтому отправка
+    // обходит только подписчиков своей темы, а не всех участников. Отправитель
+    // своё сообщение не получает - как и в ConcreteMediator.
+
+    class TopicMediator;
+
+    // Почтовый ящик участника: очередь Вьюкова "много писателей - один читатель"
+    // без блокировок. Писатель - одна атомарная замена головы; читает ящик
+    // только тот поток исполнителя, который сейчас его обслуживает.
+    class Mailbox {
+    public:
+        struct Node {
+            std::atomic<Node*> next{ nullptr };
+            std::string topic;
+            std::string message;
+        };
+
+        Mailbox() : head(&stub), tail(&stub) { }
+        ~Mailbox() {
+            while (Node* node = Pop()) delete node;
+        }
+
+        Mailbox(const Mailbox&) = delete;
+        Mailbox& operator=(const Mailbox&) = delete;
+
+        // Из любого потока
+        void Push(Node* node) {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            Node* previous = head.exchange(node, std::memory_order_seq_cst);
+            previous->next.store(node, std::memory_order_release);
+        }
+
+        // Только читатель. nullptr - ящик пуст или писатель ещё не дописал узел
+        Node* Pop() {
+            Node* first = tail;
+            Node* next = first->next.load(std::memory_order_acquire);
+            if (first == &stub) {
+                if (!next) return nullptr;
+                tail = next;
+                first = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                tail = next;
+                return first;
+            }
+            if (first != head.load(std::memory_order_acquire)) return nullptr;
+            Push(&stub);
+            next = first->next.load(std::memory_order_acquire);
+            if (!next) return nullptr;
+            tail = next;
+            return first;
+        }
+
+    private:
+        std::atomic<Node*> head;
+        Node* tail;
+        Node stub;
+    };
+
+    class TopicColleague abstract {
+    protected:
+        TopicMediator* mediator_;
+    public:
+        explicit TopicColleague(TopicMediator* mediator) : mediator_(mediator) { }
+        virtual ~TopicColleague() = default;
+
+        // Возвращает число получателей
+        std::size_t Send(std::string_view topic, std::string const& message);
+        virtual void Notify(std::string_view topic, std::string const& message) = 0;
+    };
+
+    class TopicMediator {
+    public:
+        virtual ~TopicMediator() = default;
+
+        void Subscribe(std::string_view topic, TopicColleague* colleague) {
+            auto found = topics.find(topic);
+            if (found == topics.end())
+                found = topics.emplace(std::string(topic), std::vector<TopicColleague*>()).first;
+            std::vector<TopicColleague*>& subscribers = found->second;
+            if (std::find(subscribers.begin(), subscribers.end(), colleague) != subscribers.end()) return;
+            subscribers.push_back(colleague);
+            auto [membership, first] = memberships.try_emplace(colleague);
+            membership->second.push_back(found->first);
+            if (first) Joined(colleague);
+        }
+
+        void Unsubscribe(std::string_view topic, TopicColleague* colleague) {
+            auto membership = memberships.find(colleague);
+            if (membership == memberships.end()) return;
+            std::vector<std::string>& joined = membership->second;
+            auto position = std::find(joined.begin(), joined.end(), topic);
+            if (position == joined.end()) return;
+            joined.erase(position);
+            Remove(topic, colleague);
+            if (!joined.empty()) return;
+            memberships.erase(membership);
+            Left(colleague);
+        }
+
+        // Снимает участника со всех тем; вызывается до его удаления
+        void Unregister(TopicColleague* colleague) {
+            auto membership = memberships.find(colleague);
+            if (membership == memberships.end()) return;
+            for (const std::string& topic : membership->second)
+                Remove(topic, colleague);
+            memberships.erase(membership);
+            Left(colleague);
+        }
+
+        std::size_t Send(std::string_view topic, std::string const& message, TopicColleague* sender) {
+            auto found = topics.find(topic);
+            if (found == topics.end()) return 0;
+            std::size_t delivered = 0;
+            for (TopicColleague* colleague : found->second) {
+                if (colleague == sender) continue;
+                Deliver(colleague, found->first, message);
+                ++delivered;
+            }
+            return delivered;
+        }
+
+        std::size_t Subscribers(std::string_view topic) const {
+            auto found = topics.find(topic);
+            return found == topics.end() ? 0 : found->second.size();
+        }
+        std::size_t Topics() const { return topics.size(); }
+    protected:
+        virtual void Deliver(TopicColleague* colleague, std::string_view topic, std::string const& message) {
+            colleague->Notify(topic, message);
+        }
+        // Участник подписался на первую тему / отписался от последней
+        virtual void Joined(TopicColleague*) { }
+        virtual void Left(TopicColleague*) { }
+    private:
+        // Поиск по string_view без создания временной строки
+        struct TopicHash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view topic) const { return std::hash<std::string_view>()(topic); }
+        };
+
+        void Remove(std::string_view topic, TopicColleague* colleague) {
+            auto found = topics.find(topic);
+            std::vector<TopicColleague*>& subscribers = found->second;
+            subscribers.erase(std::find(subscribers.begin(), subscribers.end(), colleague));
+            if (subscribers.empty()) topics.erase(found);
+        }
+
+        std::unordered_map<std::string, std::vector<TopicColleague*>, TopicHash, std::equal_to<>> topics;
+        std::unordered_map<TopicColleague*, std::vector<std::string>> memberships;
+    };
+
+    inline std::size_t TopicColleague::Send(std::string_view topic, std::string const& message) {
+        return mediator_->Send(topic, message, this);
+    }
+
+    class NamedColleague : public TopicColleague {
+    public:
+        NamedColleague(TopicMediator* mediator, std::string name) : TopicColleague(mediator), name(std::move(name)) { }
+
+        void Notify(std::string_view topic, std::string const& message) override {
+            std::cout << name << " gets message '" << message << "' on " << topic << std::endl;
+        }
+    private:
+        std::string name;
+    };
+
+    // Посредник с исполнителем: отправка только кладёт сообщение в ящики
+    // подписчиков, а уведомления вызывают потоки общего исполнителя. Ящики
+    // принадлежат посреднику и заводятся при первой подписке участника. Ящик
+    // ставится в очередь готовых тем, кто увеличил его счётчик сообщений с нуля,
+    // и остаётся у исполнителя, пока счётчик не вернётся к нулю, поэтому Notify
+    // одного участника никогда не выполняется в двух потоках сразу, а медленный
+    // получатель не задерживает отправителей.
+    // Подписки настраиваются до начала отправки: Send() из многих потоков
+    // только читает индекс тем. Unregister() дожидается доставки всех
+    // отправленных сообщений, после него участника можно удалять.
+    class ThreadedTopicMediator : public TopicMediator {
+    public:
+        // Сообщений одного ящика за раз, чтобы остальные ящики не ждали
+        static constexpr std::size_t drain_budget = 64;
+
+        explicit ThreadedTopicMediator(std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+            for (std::size_t i = 0; i < threads; ++i)
+                workers.emplace_back([this] { Run(); });
+        }
+        ~ThreadedTopicMediator() override {
+            Drain();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeup.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        // Ждёт, пока все отправленные сообщения будут доставлены и исполнитель
+        // перестанет обращаться к ящикам их получателей
+        void Drain() const {
+            while (in_flight.load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+        }
+    protected:
+        void Deliver(TopicColleague* colleague, std::string_view topic, std::string const& message) override {
+            Inbox& inbox = *inboxes.find(colleague)->second;
+            in_flight.fetch_add(1, std::memory_order_relaxed);
+            bool idle = inbox.pending.fetch_add(1, std::memory_order_acq_rel) == 0;
+            inbox.mailbox.Push(new Mailbox::Node{ {}, std::string(topic), message });
+            if (idle) Schedule(&inbox);
+        }
+        void Joined(TopicColleague* colleague) override {
+            inboxes.emplace(colleague, std::make_unique<Inbox>(colleague));
+        }
+        void Left(TopicColleague* colleague) override {
+            Drain();
+            inboxes.erase(colleague);
+        }
+    private:
+        struct Inbox {
+            explicit Inbox(TopicColleague* colleague) : colleague(colleague) { }
+
+            TopicColleague* colleague;
+            Mailbox mailbox;
+            std::atomic<std::size_t> pending{ 0 };   // отправленные в ящик и ещё не обработанные
+        };
+
+        // in_flight считает недоставленные сообщения и ходы исполнителя в очереди
+        // готовых: ход засчитывается вместе со своими сообщениями только после
+        // последнего обращения к ящику, поэтому нулевой счётчик означает, что
+        // ящики никто не трогает
+        void Schedule(Inbox* inbox) {
+            in_flight.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.push_back(inbox);
+            }
+            wakeup.notify_one();
+        }
+
+        void Run() {
+            for (;;) {
+                Inbox* inbox;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wakeup.wait(lock, [this] { return stopping || !ready.empty(); });
+                    if (ready.empty()) return;
+                    inbox = ready.front();
+                    ready.pop_front();
+                }
+                std::size_t handled = 0;
+                while (handled < drain_budget) {
+                    Mailbox::Node* node = inbox->mailbox.Pop();
+                    if (!node) break;
+                    inbox->colleague->Notify(node->topic, node->message);
+                    delete node;
+                    ++handled;
+                }
+                // Ящик остаётся за исполнителем, если в нём ещё есть сообщения, в том
+                // числе недописанные писателем или пришедшие сверх бюджета
+                if (inbox->pending.fetch_sub(handled, std::memory_order_acq_rel) != handled) {
+                    if (handled == 0) std::this_thread::yield();
+                    Schedule(inbox);
+                }
+                in_flight.fetch_sub(handled + 1, std::memory_order_release);
+            }
+        }
+
+        std::unordered_map<TopicColleague*, std::unique_ptr<Inbox>> inboxes;
+        std::atomic<std::uint64_t> in_flight{ 0 };
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::deque<Inbox*> ready;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+
     void test_mediator() {
         ConcreteMediator m;
         ConcreteColleague1 c1(&m);
@@ -86,5 +380,159 @@ namespace Behavioral {
         m.SetColleague2(&c2);
         c1.Send("How are you?");
         c2.Send("Fine, thanks");
+
+        TopicMediator topics;
+        NamedColleague alice(&topics, "Alice"), bob(&topics, "Bob"), carol(&topics, "Carol");
+        topics.Subscribe("news", &alice);
+        topics.Subscribe("news", &bob);
+        topics.Subscribe("sport", &carol);
+        topics.Subscribe("sport", &alice);
+        alice.Send("news", "How are you?");
+        carol.Send("sport", "Fine, thanks");
+        topics.Unregister(&alice);
+        bob.Send("news", "Anyone here?");
+
+        // Доставка в потоках исполнителя: Send лишь кладёт сообщения в ящики
+        {
+            ThreadedTopicMediator threaded(2);
+            NamedColleague dave(&threaded, "Dave"), erin(&threaded, "Erin");
+            threaded.Subscribe("alerts", &dave);
+            threaded.Subscribe("alerts", &erin);
+            erin.Send("alerts", "Disk is almost full");
+            // Unregister дожидается доставки, после него участников можно удалять
+            threaded.Unregister(&dave);
+            threaded.Unregister(&erin);
+        }
+    }
+
+    // Участник, который только считает полученные сообщения
+    class CountingColleague : public TopicColleague {
+    public:
+        using TopicColleague::TopicColleague;
+        void Notify(std::string_view, std::string const&) override { ++received; }
+        std::size_t received = 0;
+    };
+
+    // 10 тысяч участников, каждый подписан на 5 случайных тем из тысячи: отправка
+    // через индекс тем против просмотра всех участников, как пришлось бы делать
+    // посреднику без индекса
+    void benchmark_topic_mediator() {
+        constexpr std::size_t colleagues = 10000, topic_count = 1000, sends = 200000;
+        TopicMediator mediator;
+        std::vector<std::string> topics;
+        for (std::size_t t = 0; t < topic_count; ++t) topics.push_back("topic/" + std::to_string(t));
+        std::vector<std::unique_ptr<CountingColleague>> members;
+        std::vector<std::vector<std::size_t>> joined(colleagues);
+        std::uint64_t seed = 88172645463325252ull;
+        auto next = [&seed] {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return seed;
+        };
+        for (std::size_t i = 0; i < colleagues; ++i) {
+            members.push_back(std::make_unique<CountingColleague>(&mediator));
+            for (int k = 0; k < 5; ++k) {
+                std::size_t topic = next() % topic_count;
+                mediator.Subscribe(topics[topic], members.back().get());
+                if (std::find(joined[i].begin(), joined[i].end(), topic) == joined[i].end()) joined[i].push_back(topic);
+            }
+        }
+        std::vector<std::pair<std::size_t, std::size_t>> load(sends);
+        for (auto& send : load) send = { std::size_t(next() % colleagues), std::size_t(next() % topic_count) };
+        std::string message = "hello";
+
+        std::size_t delivered = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto [sender, topic] : load) delivered += members[sender]->Send(topics[topic], message);
+        double indexed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / sends;
+
+        // Просмотр всех участников на каждую отправку: в сто раз меньше отправок
+        std::size_t scanned_sends = sends / 100, scanned = 0, expected = 0;
+        for (std::size_t k = 0; k < scanned_sends; ++k) expected += members[load[k].first]->Send(topics[load[k].second], message);
+        start = std::chrono::steady_clock::now();
+        for (std::size_t k = 0; k < scanned_sends; ++k) {
+            auto [sender, topic] = load[k];
+            for (std::size_t i = 0; i < colleagues; ++i) {
+                if (i == sender || std::find(joined[i].begin(), joined[i].end(), topic) == joined[i].end()) continue;
+                members[i]->Notify(topics[topic], message);
+                ++scanned;
+            }
+        }
+        double scan = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / scanned_sends;
+        std::cout << "Индекс тем: " << indexed << " нс на отправку (" << double(delivered) / sends
+            << " получателей), просмотр всех участников: " << scan << " нс на отправку";
+        if (scanned != expected) std::cout << ", получатели разошлись";
+        std::cout << "\n";
+    }
+
+    // Участник, который запоминает задержку доставки: сообщение несёт время отправки
+    class LatencyColleague : public TopicColleague {
+    public:
+        using TopicColleague::TopicColleague;
+        void Notify(std::string_view, std::string const& message) override {
+            std::int64_t sent;
+            std::memcpy(&sent, message.data(), sizeof(sent));
+            latencies.push_back(std::chrono::steady_clock::now().time_since_epoch().count() - sent);
+        }
+        std::vector<std::int64_t> latencies;
+    };
+
+    // Много отправителей, 1000 участников на 100 темах и 2 потока исполнителя:
+    // пропускная способность и задержка доставки. Без пауз отправители обгоняют
+    // исполнитель, и задержка - это ожидание в накопившейся очереди; с паузой после
+    // каждых 10 отправок поток сообщений остаётся ниже пропускной способности
+    void benchmark_threaded_mediator() {
+        constexpr std::size_t colleagues = 1000, topic_count = 100, sends = 100000;
+        auto measure = [](std::size_t producers, std::chrono::microseconds pause) {
+            std::vector<std::string> topics;
+            for (std::size_t t = 0; t < topic_count; ++t) topics.push_back("topic/" + std::to_string(t));
+            std::vector<std::unique_ptr<LatencyColleague>> members;
+            ThreadedTopicMediator mediator(2);
+            for (std::size_t i = 0; i < colleagues; ++i) {
+                members.push_back(std::make_unique<LatencyColleague>(&mediator));
+                members.back()->latencies.reserve(2 * sends / topic_count);
+                mediator.Subscribe(topics[i % topic_count], members.back().get());
+            }
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (std::size_t p = 0; p < producers; ++p)
+                threads.emplace_back([&, p] {
+                    std::uint64_t seed = 88172645463325252ull + p;
+                    std::string message(16, ' ');
+                    for (std::size_t k = 0; k < sends / producers; ++k) {
+                        seed ^= seed << 13;
+                        seed ^= seed >> 7;
+                        seed ^= seed << 17;
+                        std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+                        std::memcpy(message.data(), &now, sizeof(now));
+                        members[seed % colleagues]->Send(topics[(seed >> 32) % topic_count], message);
+                        if (pause.count() && k % 10 == 9) std::this_thread::sleep_for(pause);
+                    }
+                });
+            for (std::thread& thread : threads) thread.join();
+            mediator.Drain();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::vector<std::int64_t> all;
+            for (auto& member : members) {
+                all.insert(all.end(), member->latencies.begin(), member->latencies.end());
+                mediator.Unregister(member.get());
+            }
+            std::sort(all.begin(), all.end());
+            auto microseconds = [&all](std::size_t index) {
+                return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::duration(all[index])).count();
+            };
+            std::cout << producers << " отправителей" << (pause.count() ? " с паузами" : "") << ": "
+                << double(all.size()) / seconds / 1e6 << " млн доставок в секунду, p50 "
+                << microseconds(all.size() / 2) << " мкс, p99 " << microseconds(all.size() * 99 / 100) << " мкс\n";
+        };
+        for (std::size_t producers : { 1, 2, 4, 8 })
+            measure(producers, std::chrono::microseconds(0));
+        measure(8, std::chrono::microseconds(1000));
+    }
+
+    void benchmark_mediator() {
+        benchmark_topic_mediator();
+        benchmark_threaded_mediator();
     }
 }
\ No newline at end of file
@@ -12,6 +12,40 @@
 #pragma once
 #include <string>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <functional>
+#include <string_view>
+#include <tuple>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
  //   ""
 namespace onception {
@@ -65,8 +99,17 @@ namespace 
 namespace Behavioral {
 
     class Memento {
+    public:
+        //         
+        Memento() = default;
+
+        std::chrono::system_clock::time_point getTime() const {
+            return time;
+        }
     private:
         friend class Originator;
+        friend class MementoSpill;
+        friend class CareTaker;
 
         Memento(const int s) : state(s) {}
 
@@ -77,7 +120,8 @@ namespace Behavioral {
             return state;
         }
     private:
-        int state;
+        int state = 0;
+        std::chrono::system_clock::time_point time;  //  
     };
 
     class Originator {
@@ -89,28 +133,722 @@ namespace Behavioral {
         int getState() {
             return state;
         }
-        void setMemento(Memento* const m) {
-            state = m->getState();
+        void setMemento(const Memento& m) {
+            state = m.state;
         }
-        Memento* createMemento() {
-            return new Memento(state);
+        Memento createMemento() const {
+            return Memento(state);
         }
     private:
         int state;
     };
 
-    class CareTaker {
+    //     :     ,
+    //      ,       .
+    class MementoRing {
     public:
-        CareTaker(Originator* const o) : originator(o) {}
+        explicit MementoRing(std::size_t capacity) : slots(capacity ? capacity : 1) {}
+
+        bool empty() const { return count == 0; }
+        bool full() const { return count == slots.size(); }
+        std::size_t size() const { return count; }
+        std::size_t capacity() const { return slots.size(); }
+
+        //    ,   
+        void push_back(const Memento& m) {
+            slots[wrap(first + count)] = m;
+            ++count;
+        }
+        void pop_back() { --count; }
+        void pop_front() {
+            first = wrap(first + 1);
+            --count;
+        }
+        Memento& back() { return slots[wrap(first + count - 1)]; }
+        Memento& front() { return slots[first]; }
+        Memento& operator[](std::size_t i) { return slots[wrap(first + i)]; }
+    private:
+        std::size_t wrap(std::size_t i) const { return i < slots.size() ? i : i - slots.size(); }
+
+        std::vector<Memento> slots;
+        std::size_t first = 0;
+        std::size_t count = 0;
+    };
+
+    // ,      
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER length;
+            if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length))
+                throw std::runtime_error("Unable to open " + path);
+            bytes = std::size_t(length.QuadPart);
+            if (bytes) {
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping) view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+#else
+            file = ::open(path.c_str(), O_RDONLY);
+            struct stat info;
+            if (file < 0 || ::fstat(file, &info) != 0)
+                throw std::runtime_error("Unable to open " + path);
+            bytes = std::size_t(info.st_size);
+            if (bytes) {
+                void* address = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, 0);
+                if (address != MAP_FAILED) view = static_cast<const char*>(address);
+            }
+#endif
+            if (bytes && !view) {
+                close();
+                throw std::runtime_error("Unable to map " + path);
+            }
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() { close(); }
+
+        const char* data() const { return view; }
+        std::size_t size() const { return bytes; }
+    private:
+        void close() {
+#ifdef _WIN32
+            if (view) UnmapViewOfFile(view);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+            if (view) ::munmap(const_cast<char*>(view), bytes);
+            if (file >= 0) ::close(file);
+#endif
+            view = nullptr;
+        }
+
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int file = -1;
+#endif
+        const char* view = nullptr;
+        std::size_t bytes = 0;
+    };
+
+    //   : ,   ,  ,
+    //   (      zigzag-varint)  
+    //   .   :      
+    //           ,  
+    //    .  -   ;  
+    //   index_capacity  ,   
+    //   path + ".index"  ,    .
+    //   -  ,     .
+    class MementoSpill {
+    public:
+        //    :  varint  10 
+        static constexpr std::size_t max_encoded = 20;
+
+        MementoSpill(const std::string& path, std::size_t block_size, std::size_t index_capacity)
+            : path(path), index_path(path + ".index"), block_size(block_size ? block_size : 1),
+              index_capacity(std::max<std::size_t>(2, index_capacity)) {
+            std::remove(path.c_str());
+            std::remove(index_path.c_str());
+            pending.reserve(this->block_size);
+            encoded.reserve(this->block_size * max_encoded);
+            recent.reserve(this->index_capacity);
+        }
+        MementoSpill(const MementoSpill&) = delete;
+        MementoSpill& operator=(const MementoSpill&) = delete;
+        ~MementoSpill() {
+            std::remove(path.c_str());
+            std::remove(index_path.c_str());
+        }
 
-        ~CareTaker() {
-            for (unsigned int i = 0; i < history.size(); i++) {
-                delete history.at(i);
+        // ,      
+        static std::size_t residentFor(std::size_t block_size, std::size_t index_capacity) {
+            return block_size * (sizeof(Memento) + max_encoded) + std::max<std::size_t>(2, index_capacity) * sizeof(Block);
+        }
+
+        //      
+        void push(const Memento& m) {
+            pending.push_back(m);
+            if (pending.size() == block_size) write();
+        }
+        //   ring   ; ring      
+        bool restore(MementoRing& ring) {
+            if (pending.empty()) {
+                if (recent.empty() && paged == 0) return false;
+                read();
+            }
+            for (const Memento& m : pending) ring.push_back(m);
+            pending.clear();
+            return true;
+        }
+        //      t,   :  
+        //   (     )    
+        bool find(std::chrono::system_clock::time_point t, Memento& out) const {
+            if (!pending.empty() && pending.front().time <= t) return latestNotAfter(pending, t, out);
+            Block block;
+            if (!recent.empty() && recent.front().first_time <= t) {
+                auto next = std::upper_bound(recent.begin(), recent.end(), t,
+                    [](std::chrono::system_clock::time_point time, const Block& b) { return time < b.first_time; });
+                block = *(next - 1);
+            }
+            else {
+                if (paged == 0) return false;
+                MappedFile index(index_path);
+                std::size_t low = 0, high = paged;
+                while (low < high) {
+                    std::size_t middle = low + (high - low) / 2;
+                    if (record(index, middle).first_time <= t) low = middle + 1;
+                    else high = middle;
+                }
+                if (low == 0) return false;
+                block = record(index, low - 1);
+            }
+            std::vector<Memento> mementos;
+            mementos.reserve(block.count);
+            decode(block, mementos);
+            return latestNotAfter(mementos, t, out);
+        }
+        std::size_t size() const { return stored + pending.size(); }
+        std::size_t blockSize() const { return block_size; }
+        // ,         
+        std::size_t residentBytes() const {
+            return pending.capacity() * sizeof(Memento) + encoded.capacity() + recent.capacity() * sizeof(Block);
+        }
+    private:
+        struct Block {
+            std::uint64_t offset;
+            std::uint32_t bytes;
+            std::uint32_t count;
+            std::chrono::system_clock::time_point first_time;  //     
+        };
+
+        static bool latestNotAfter(const std::vector<Memento>& mementos, std::chrono::system_clock::time_point t, Memento& out) {
+            auto next = std::upper_bound(mementos.begin(), mementos.end(), t,
+                [](std::chrono::system_clock::time_point time, const Memento& m) { return time < m.time; });
+            if (next == mementos.begin()) return false;
+            out = *(next - 1);
+            return true;
+        }
+        static Block record(const MappedFile& index, std::size_t i) {
+            Block block;
+            std::memcpy(&block, index.data() + i * sizeof(Block), sizeof(Block));
+            return block;
+        }
+
+        static void putVarint(std::vector<char>& out, std::uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(char(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(char(value));
+        }
+        static std::uint64_t getVarint(const char*& in) {
+            std::uint64_t value = 0;
+            for (unsigned shift = 0;; shift += 7) {
+                std::uint8_t byte = std::uint8_t(*in++);
+                value |= std::uint64_t(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
             }
+        }
+        static std::uint64_t zigzag(std::int64_t v) { return (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63); }
+        static std::int64_t unzigzag(std::uint64_t v) { return std::int64_t(v >> 1) ^ -std::int64_t(v & 1); }
+
+        void write() {
+            encoded.clear();
+            std::int64_t previous = 0, previous_time = 0;
+            for (const Memento& m : pending) {
+                std::int64_t time = m.time.time_since_epoch().count();
+                putVarint(encoded, zigzag(std::int64_t(m.state) - previous));
+                putVarint(encoded, zigzag(time - previous_time));
+                previous = m.state;
+                previous_time = time;
+            }
+            std::FILE* file = std::fopen(path.c_str(), "ab");
+            bool written = file && std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+            if (file) std::fclose(file);
+            if (!written) throw std::runtime_error("Unable to write " + path);
+            if (recent.size() == index_capacity) pageOut();
+            recent.push_back({ end, std::uint32_t(encoded.size()), std::uint32_t(pending.size()), pending.front().time });
+            end += encoded.size();
+            stored += pending.size();
+            pending.clear();
+        }
+        void decode(const Block& block, std::vector<Memento>& out) const {
+            MappedFile file(path);
+            const char* in = file.data() + block.offset;
+            std::int64_t previous = 0, previous_time = 0;
+            for (std::uint32_t i = 0; i < block.count; ++i) {
+                previous += unzigzag(getVarint(in));
+                previous_time += unzigzag(getVarint(in));
+                Memento m(static_cast<int>(previous));
+                m.time = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(previous_time));
+                out.push_back(m);
+            }
+        }
+        //    :     
+        void read() {
+            if (recent.empty()) pageIn();
+            Block block = recent.back();
+            decode(block, pending);
+            recent.pop_back();
+            stored -= block.count;
+        }
+        //         
+        void pageOut() {
+            std::size_t count = index_capacity / 2;
+            std::FILE* file = std::fopen(index_path.c_str(), index_created ? "r+b" : "wb");
+            bool written = file && std::fseek(file, long(paged * sizeof(Block)), SEEK_SET) == 0
+                && std::fwrite(recent.data(), sizeof(Block), count, file) == count;
+            if (file) std::fclose(file);
+            if (!written) throw std::runtime_error("Unable to write " + index_path);
+            index_created = true;
+            recent.erase(recent.begin(), recent.begin() + count);
+            paged += count;
+        }
+        void pageIn() {
+            std::size_t count = std::min(paged, index_capacity / 2);
+            MappedFile index(index_path);
+            for (std::size_t i = paged - count; i < paged; ++i) recent.push_back(record(index, i));
+            paged -= count;
+        }
+
+        std::string path;
+        std::string index_path;
+        std::size_t block_size;
+        std::size_t index_capacity;
+        std::vector<Memento> pending;
+        std::vector<char> encoded;
+        std::vector<Block> recent;     //    
+        std::size_t paged = 0;         //     
+        bool index_created = false;
+        std::uint64_t end = 0;         //  :    
+        std::size_t stored = 0;
+    };
+
+    //   :   age    
+    //   resolution (0 -  )
+    struct RetentionTier {
+        std::chrono::system_clock::duration age;
+        std::chrono::system_clock::duration resolution;
+    };
+
+    //     , :     ,
+    //             . , 
+    //    ,    ,     
+    //    ,  ;     
+    //  ,    O(1)   save().
+    //        capacity .   
+    //        ,   - 
+    //   spill_path.      ,    :
+    // ,       ,   
+    //   memory_budget,       .
+    class CareTaker {
+    public:
+        using clock = std::chrono::system_clock;
+
+        CareTaker(Originator* const o, std::size_t capacity = 1024)
+            : originator(o), capacity(capacity) {
+            setRetention({ { clock::duration::max(), clock::duration::zero() } });
+        }
+        CareTaker(Originator* const o, const std::string& spill_path, std::size_t memory_budget)
+            : originator(o), capacity(0), spill_path(spill_path), memory_budget(memory_budget) {
+            setRetention({ { clock::duration::max(), clock::duration::zero() } });
+        }
+
+        //     ;     
+        void setRetention(std::vector<RetentionTier> tiers) {
+            if (size() != 0) throw std::logic_error("Retention policy must be set before the first save");
+            if (tiers.empty()) tiers.push_back({ clock::duration::max(), clock::duration::zero() });
+            policy = std::move(tiers);
+            if (memory_budget) divideBudget();
             history.clear();
+            for (std::size_t i = 0; i < policy.size(); ++i) history.emplace_back(capacity);
         }
-        void save() {
+
+        void save() { save(clock::now()); }
+        void save(clock::time_point now) {
             std::cout << "Save state." << std::endl;
+            Memento m = originator->createMemento();
+            m.time = now;
+            admit(0, m);
+            for (std::size_t tier = 0; tier + 1 < policy.size(); ++tier) {
+                MementoRing& ring = history[tier];
+                while (!ring.empty() && now - ring.front().time > policy[tier].age) {
+                    Memento aged = ring.front();
+                    ring.pop_front();
+                    admit(tier + 1, aged);
+                }
+            }
+        }
+        void undo() {
+            MementoRing* ring = newest();
+            if (!ring && spill && spill->restore(history.back())) ring = &history.back();
+            if (!ring) {
+                std::cout << "Unable to undo state." << std::endl;
+                return;
+            }
+            originator->setMemento(ring->back());
+            std::cout << "Undo state." << std::endl;
+            ring->pop_back();
+        }
+        //     t -     t -  
+        //   .    ,   -  
+        //          : O(log n).
+        bool restoreTo(clock::time_point t) {
+            for (MementoRing& ring : history) {
+                if (ring.empty() || t < ring.front().time) continue;
+                std::size_t low = 0, high = ring.size();
+                while (low < high) {
+                    std::size_t middle = low + (high - low) / 2;
+                    if (ring[middle].time <= t) low = middle + 1;
+                    else high = middle;
+                }
+                originator->setMemento(ring[low - 1]);
+                std::cout << "Restore state." << std::endl;
+                return true;
+            }
+            Memento m;
+            if (spill && spill->find(t, m)) {
+                originator->setMemento(m);
+                std::cout << "Restore state." << std::endl;
+                return true;
+            }
+            std::cout << "Unable to restore state." << std::endl;
+            return false;
+        }
+        std::size_t size() const {
+            std::size_t total = spill ? spill->size() : 0;
+            for (const MementoRing& ring : history) total += ring.size();
+            return total;
+        }
+        std::size_t residentBytes() const {
+            std::size_t total = spill ? spill->residentBytes() : 0;
+            for (const MementoRing& ring : history) total += ring.capacity() * sizeof(Memento);
+            return total;
+        }
+    private:
+        //     tier     
+        void admit(std::size_t tier, const Memento& m) {
+            MementoRing& ring = history[tier];
+            auto resolution = policy[tier].resolution;
+            if (resolution > clock::duration::zero() && !ring.empty()
+                && ring.back().time.time_since_epoch() / resolution == m.time.time_since_epoch() / resolution)
+                return;
+            if (ring.full()) {
+                Memento oldest = ring.front();
+                ring.pop_front();
+                if (tier + 1 < history.size()) admit(tier + 1, oldest);
+                else if (spill) spill->push(oldest);
+            }
+            ring.push_back(m);
+        }
+        //   ,       
+        //  .   -  :      
+        void divideBudget() {
+            auto resident = [this](std::size_t slots) {
+                std::size_t block = std::max<std::size_t>(1, slots / 4);
+                return policy.size() * slots * sizeof(Memento) + MementoSpill::residentFor(block, block);
+            };
+            std::size_t slots = memory_budget / (policy.size() * sizeof(Memento));
+            while (slots && resident(slots) > memory_budget) slots -= std::max<std::size_t>(1, slots / 64);
+            if (slots == 0) throw std::invalid_argument("Memory budget is too small for the retention policy");
+            while (resident(slots + 1) <= memory_budget) ++slots;
+            capacity = slots;
+            std::size_t block = std::max<std::size_t>(1, slots / 4);
+            spill.reset();
+            spill = std::make_unique<MementoSpill>(spill_path, block, block);
+        }
+        MementoRing* newest() {
+            for (MementoRing& ring : history)
+                if (!ring.empty()) return &ring;
+            return nullptr;
+        }
+
+        Originator* originator;
+        std::size_t capacity;
+        std::string spill_path;
+        std::size_t memory_budget = 0;  // 0 -   ,    
+        std::vector<RetentionTier> policy;
+        std::vector<MementoRing> history;  //  0 -   
+        std::unique_ptr<MementoSpill> spill;
+    };
+
+    // -  ,   .
+    //    ;    ,  
+    //   .  keyframe_interval-  -  (),
+    //      keyframe_interval - 1 .
+    class DocumentMemento {
+    private:
+        friend class DocumentOriginator;
+        friend class DocumentCareTaker;
+
+        DocumentMemento() = default;
+
+        std::size_t size = 0;            //     
+        std::size_t chain = 0;           //     , 0 - 
+        std::vector<std::size_t> pages;  //   (   )
+        std::vector<char> bytes;         //      
+    public:
+        bool isKeyframe() const { return chain == 0; }
+        std::size_t storedBytes() const {
+            return bytes.size() + pages.size() * sizeof(std::size_t);
+        }
+    };
+
+    class DocumentOriginator {
+    public:
+        static constexpr std::size_t page_size = 4096;
+
+        void write(std::size_t offset, const char* data, std::size_t count) {
+            if (offset + count > document.size()) resize(offset + count);
+            std::memcpy(document.data() + offset, data, count);
+            markDirty(offset, count);
+        }
+        void resize(std::size_t size) {
+            std::size_t old = document.size();
+            document.resize(size);
+            dirty.resize(pageCount(), false);
+            if (size > old) markDirty(old, size - old);
+        }
+        const char* data() const { return document.data(); }
+        std::size_t size() const { return document.size(); }
+
+        DocumentMemento createMemento(std::size_t chain) {
+            DocumentMemento m;
+            m.size = document.size();
+            m.chain = chain;
+            if (chain == 0) {
+                m.bytes = document;
+            }
+            else {
+                for (std::size_t page = 0; page < dirty.size(); ++page) {
+                    if (!dirty[page]) continue;
+                    m.pages.push_back(page);
+                    auto first = document.begin() + page * page_size;
+                    auto last = document.begin() + std::min(document.size(), (page + 1) * page_size);
+                    m.bytes.insert(m.bytes.end(), first, last);
+                }
+            }
+            std::fill(dirty.begin(), dirty.end(), false);
+            return m;
+        }
+        //         
+        void setMemento(const DocumentMemento& m) {
+            if (m.isKeyframe()) {
+                document = m.bytes;
+                dirty.assign(pageCount(), false);
+                return;
+            }
+            document.resize(m.size);
+            dirty.resize(pageCount(), false);
+            std::size_t offset = 0;
+            for (std::size_t page : m.pages) {
+                std::size_t count = std::min(page_size, m.size - page * page_size);
+                std::memcpy(document.data() + page * page_size, m.bytes.data() + offset, count);
+                offset += count;
+            }
+        }
+        //   ,   m   
+        void markChanged(const DocumentMemento& m) {
+            if (m.isKeyframe()) {
+                std::fill(dirty.begin(), dirty.end(), true);
+                return;
+            }
+            for (std::size_t page : m.pages)
+                if (page < dirty.size()) dirty[page] = true;
+        }
+    private:
+        std::size_t pageCount() const { return (document.size() + page_size - 1) / page_size; }
+        void markDirty(std::size_t offset, std::size_t count) {
+            if (count == 0) return;
+            for (std::size_t page = offset / page_size; page <= (offset + count - 1) / page_size; ++page)
+                dirty[page] = true;
+        }
+
+        std::vector<char> document;
+        std::vector<bool> dirty;
+    };
+
+    class DocumentCareTaker {
+    public:
+        DocumentCareTaker(DocumentOriginator* const o, std::size_t keyframe_interval = 16)
+            : originator(o), keyframe_interval(keyframe_interval ? keyframe_interval : 1) {}
+
+        void save() {
+            std::size_t chain = 0;
+            if (!history.empty() && history.back().chain + 1 < keyframe_interval)
+                chain = history.back().chain + 1;
+            history.push_back(originator->createMemento(chain));
+            stored += history.back().storedBytes();
+        }
+        //   :     
+        // keyframe_interval - 1   
+        void undo() {
+            if (history.empty()) {
+                std::cout << "Unable to undo state." << std::endl;
+                return;
+            }
+            std::size_t last = history.size() - 1;
+            for (std::size_t i = last - history[last].chain; i <= last; ++i)
+                originator->setMemento(history[i]);
+            //      
+            originator->markChanged(history[last]);
+            stored -= history[last].storedBytes();
+            history.pop_back();
+        }
+        std::size_t size() const { return history.size(); }
+        std::size_t storedBytes() const { return stored; }
+    private:
+        DocumentOriginator* originator;
+        std::size_t keyframe_interval;
+        std::size_t stored = 0;
+        std::vector<DocumentMemento> history;
+    };
+
+
+    //    : 32-     1 .
+    //  -    ,    O(1).  
+    //      ,       ;
+    // ,    ,   .
+    struct PersistentNode {
+        std::vector<std::shared_ptr<PersistentNode>> children;  //   
+        std::vector<char> bytes;                                //   
+    };
+
+    class PersistentMemento {
+    public:
+        PersistentMemento() = default;
+    private:
+        friend class PersistentOriginator;
+        friend class PersistentCareTaker;
+
+        std::shared_ptr<PersistentNode> root;
+        std::size_t size = 0;
+        unsigned depth = 0;
+    };
+
+    class PersistentOriginator {
+    public:
+        static constexpr std::size_t leaf_size = 1024;
+        static constexpr std::size_t branching = 32;
+
+        void write(std::size_t offset, const char* data, std::size_t count) {
+            if (offset + count > length) resize(offset + count);
+            while (count) {
+                std::size_t leaf = offset / leaf_size;
+                std::size_t at = offset % leaf_size;
+                std::size_t chunk = std::min(count, leaf_size - at);
+                std::memcpy(ownLeaf(leaf).data() + at, data, chunk);
+                offset += chunk;
+                data += chunk;
+                count -= chunk;
+            }
+        }
+        //       ;     
+        void resize(std::size_t size) {
+            while (capacity() < size) {
+                if (root) {
+                    auto parent = std::make_shared<PersistentNode>();
+                    parent->children.resize(branching);
+                    parent->children[0] = std::move(root);
+                    root = std::move(parent);
+                }
+                ++depth;
+            }
+            if (size < length) truncate(size);
+            length = size;
+        }
+        char at(std::size_t offset) const {
+            const PersistentNode* node = root.get();
+            std::size_t leaf = offset / leaf_size;
+            for (unsigned level = depth; node && level > 0; --level)
+                node = node->children[(leaf / power(level - 1)) % branching].get();
+            return node ? node->bytes[offset % leaf_size] : 0;
+        }
+        std::size_t size() const { return length; }
+
+        PersistentMemento createMemento() const {
+            PersistentMemento m;
+            m.root = root;
+            m.size = length;
+            m.depth = depth;
+            return m;
+        }
+        void setMemento(const PersistentMemento& m) {
+            root = m.root;
+            length = m.size;
+            depth = m.depth;
+        }
+    private:
+        static std::size_t power(unsigned level) {
+            std::size_t result = 1;
+            while (level--) result *= branching;
+            return result;
+        }
+        std::size_t capacity() const { return leaf_size * power(depth); }
+
+        //   :     
+        static void own(std::shared_ptr<PersistentNode>& node, bool leaf) {
+            if (!node) {
+                node = std::make_shared<PersistentNode>();
+                if (leaf) node->bytes.resize(leaf_size, 0);
+                else node->children.resize(branching);
+            }
+            else if (node.use_count() > 1) {
+                node = std::make_shared<PersistentNode>(*node);
+            }
+        }
+        //          ,
+        //      
+        void truncate(std::size_t size) {
+            if (size == 0) {
+                root.reset();
+                return;
+            }
+            std::size_t leaf = (size - 1) / leaf_size;
+            std::shared_ptr<PersistentNode>* node = &root;
+            for (unsigned level = depth; level > 0 && *node; --level) {
+                own(*node, false);
+                std::size_t index = (leaf / power(level - 1)) % branching;
+                for (std::size_t i = index + 1; i < branching; ++i)
+                    (*node)->children[i].reset();
+                node = &(*node)->children[index];
+            }
+            if (*node && size % leaf_size) {
+                own(*node, true);
+                std::fill((*node)->bytes.begin() + size % leaf_size, (*node)->bytes.end(), 0);
+            }
+        }
+        std::vector<char>& ownLeaf(std::size_t leaf) {
+            std::shared_ptr<PersistentNode>* node = &root;
+            own(*node, depth == 0);
+            for (unsigned level = depth; level > 0; --level) {
+                node = &(*node)->children[(leaf / power(level - 1)) % branching];
+                own(*node, level == 1);
+            }
+            return (*node)->bytes;
+        }
+
+        std::shared_ptr<PersistentNode> root;
+        std::size_t length = 0;
+        unsigned depth = 0;
+    };
+
+    //            
+    struct SharingReport {
+        std::size_t snapshots = 0;
+        std::size_t logical_bytes = 0;
+        std::size_t stored_bytes = 0;
+    };
+
+    class PersistentCareTaker {
+    public:
+        PersistentCareTaker(PersistentOriginator* const o) : originator(o) {}
+
+        void save() {
             history.push_back(originator->createMemento());
         }
         void undo() {
@@ -118,17 +856,154 @@ namespace Behavioral {
                 std::cout << "Unable to undo state." << std::endl;
                 return;
             }
-            Memento* m = history.back();
-            originator->setMemento(m);
-            std::cout << "Undo state." << std::endl;
+            originator->setMemento(history.back());
             history.pop_back();
-            delete m;
+        }
+        SharingReport report() const {
+            SharingReport r;
+            std::unordered_set<const PersistentNode*> seen;
+            for (const PersistentMemento& m : history) {
+                ++r.snapshots;
+                r.logical_bytes += m.size;
+                r.stored_bytes += uniqueBytes(m.root.get(), seen);
+            }
+            return r;
         }
     private:
-        Originator* originator;
-        std::vector<Memento*> history;
+        static std::size_t uniqueBytes(const PersistentNode* node, std::unordered_set<const PersistentNode*>& seen) {
+            if (!node || !seen.insert(node).second) return 0;
+            std::size_t bytes = sizeof(PersistentNode) + node->bytes.size()
+                + node->children.size() * sizeof(std::shared_ptr<PersistentNode>);
+            for (const auto& child : node->children)
+                bytes += uniqueBytes(child.get(), seen);
+            return bytes;
+        }
+
+        PersistentOriginator* originator;
+        std::vector<PersistentMemento> history;
+    };
+
+    //        ,     
+    template <class State>
+    struct VersionedMemento {
+        State state;
+        std::uint64_t version;
+    };
+
+    // Originator,       ,  
+    // .   seqlock:    ,
+    //        ,   
+    // ,      .   
+    //       ,  .
+    template <class State>
+    class SeqlockOriginator {
+        static_assert(std::is_trivially_copyable_v<State>, "State must be trivially copyable");
+        static constexpr std::size_t words = (sizeof(State) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    public:
+        explicit SeqlockOriginator(const State& initial = State()) { store(initial); }
+
+        //    change(State&)   
+        template <class Change>
+        void update(Change change) {
+            std::lock_guard<std::mutex> lock(writers);
+            State state = load();
+            change(state);
+            std::uint64_t seq = sequence.load(std::memory_order_relaxed);
+            sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            store(state);
+            sequence.store(seq + 2, std::memory_order_release);
+        }
+        void setState(const State& s) {
+            update([&s](State& state) { state = s; });
+        }
+        State getState() const { return createMemento().state; }
+
+        //  ;    
+        VersionedMemento<State> createMemento() const {
+            while (true) {
+                std::uint64_t before = sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                State state = load();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before)
+                    return { state, before / 2 };
+            }
+        }
+        void setMemento(const VersionedMemento<State>& m) { setState(m.state); }
+    private:
+        State load() const {
+            std::uint64_t raw[words];
+            for (std::size_t i = 0; i < words; ++i) raw[i] = data[i].load(std::memory_order_relaxed);
+            State state;
+            std::memcpy(&state, raw, sizeof(State));
+            return state;
+        }
+        void store(const State& state) {
+            std::uint64_t raw[words] = {};
+            std::memcpy(raw, &state, sizeof(State));
+            for (std::size_t i = 0; i < words; ++i) data[i].store(raw[i], std::memory_order_relaxed);
+        }
+
+        std::atomic<std::uint64_t> sequence{ 0 };
+        std::atomic<std::uint64_t> data[words];
+        std::mutex writers;
     };
 
+    //  ,   interval  originator  
+    //   capacity     
+    template <class State>
+    class BackgroundCheckpointer {
+    public:
+        BackgroundCheckpointer(SeqlockOriginator<State>* const o, std::chrono::milliseconds interval,
+            std::size_t capacity = 1024)
+            : originator(o), interval(interval), capacity(capacity ? capacity : 1),
+              worker([this] { run(); }) {}
+        BackgroundCheckpointer(const BackgroundCheckpointer&) = delete;
+        BackgroundCheckpointer& operator=(const BackgroundCheckpointer&) = delete;
+        ~BackgroundCheckpointer() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeup.notify_one();
+            worker.join();
+        }
+
+        std::vector<VersionedMemento<State>> history() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::vector<VersionedMemento<State>>(checkpoints.begin(), checkpoints.end());
+        }
+    private:
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wakeup.wait_for(lock, interval, [this] { return stopping; })) {
+                lock.unlock();
+                VersionedMemento<State> m = originator->createMemento();
+                lock.lock();
+                if (!checkpoints.empty() && checkpoints.back().version == m.version) continue;
+                if (checkpoints.size() == capacity) checkpoints.pop_front();
+                checkpoints.push_back(m);
+            }
+        }
+
+        SeqlockOriginator<State>* originator;
+        std::chrono::milliseconds interval;
+        std::size_t capacity;
+        mutable std::mutex mutex;
+        std::condition_variable wakeup;
+        bool stopping = false;
+        std::deque<VersionedMemento<State>> checkpoints;
+        std::thread worker;
+    };
+
+    struct Account {
+        long long balance;
+        long long operations;
+    };
 
     void test_memento() {
         Originator* originator = new Originator();
@@ -145,7 +1020,282 @@ namespace Behavioral {
 
         std::cout << "Actual state is " << originator->getState() << "." << std::endl;
 
+        //   128       ,    
+        //     
+        {
+            Originator tiered;
+            CareTaker deep(&tiered, (std::filesystem::temp_directory_path() / "memento.spill").string(), 128);
+            auto start = std::chrono::system_clock::now();
+            for (int i = 1; i <= 4; i++) {
+                tiered.setState(i);
+                deep.save(start + std::chrono::seconds(i));
+            }
+            deep.restoreTo(start + std::chrono::milliseconds(2500));
+            std::cout << "State as of 2.5 s is " << tiered.getState() << "." << std::endl;
+            for (int i = 0; i < 4; i++) deep.undo();
+            std::cout << "Actual state is " << tiered.getState() << "." << std::endl;
+        }
+
+        //   1 :        
+        DocumentOriginator document;
+        DocumentCareTaker documents(&document, 8);
+        document.resize(1 << 20);
+        for (int i = 0; i < 4; i++) {
+            document.write(std::size_t(i) * 100000, "edit", 4);
+            documents.save();
+        }
+        std::cout << "Document snapshots take " << documents.storedBytes() << " bytes." << std::endl;
+        documents.undo();
+        std::cout << "Restored edit: " << std::string(document.data() + 300000, 4) << "." << std::endl;
+
+        //  :        
+        PersistentOriginator tree;
+        PersistentCareTaker edits(&tree);
+        tree.resize(1 << 20);
+        for (int i = 0; i < 100; i++) {
+            tree.write(std::size_t(i) * 10000, "x", 1);
+            edits.save();
+        }
+        SharingReport report = edits.report();
+        std::cout << report.snapshots << " snapshots of " << report.logical_bytes
+            << " bytes share " << report.stored_bytes << " bytes." << std::endl;
+
+        //    ,     
+        SeqlockOriginator<Account> account;
+        std::size_t consistent = 0, total = 0;
+        {
+            BackgroundCheckpointer<Account> checkpointer(&account, std::chrono::milliseconds(1));
+            auto writer = [&account] {
+                for (int i = 0; i < 100000; i++)
+                    account.update([](Account& a) { a.balance += 10; a.operations += 1; });
+            };
+            std::thread first(writer), second(writer);
+            first.join();
+            second.join();
+            for (const auto& m : checkpointer.history()) {
+                ++total;
+                consistent += m.state.balance == m.state.operations * 10;
+            }
+        }
+        std::cout << consistent << " of " << total << " checkpoints are consistent." << std::endl;
+
         delete originator;
         delete caretaker;
     }
+
+    //     std::cout   : CareTaker  Originator
+    //   ,        
+    class MutedOutput {
+    public:
+        MutedOutput() : state(std::cout.rdstate()) { std::cout.setstate(std::ios::badbit); }
+        ~MutedOutput() { std::cout.clear(state); }
+    private:
+        std::ios::iostate state;
+    };
+
+    inline double elapsed_seconds(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    //   :  CareTaker (std::vector<Memento*>  new/delete  
+    // )      
+    void benchmark_memento_save_undo() {
+        constexpr int rounds = 1000, depth = 1000;
+        Originator originator;
+        double pointer_rate, ring_rate;
+        {
+            MutedOutput muted;
+            std::vector<Memento*> history;
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                for (int i = 0; i < depth; ++i) {
+                    originator.setState(i);
+                    std::cout << "Save state." << std::endl;
+                    history.push_back(new Memento(originator.createMemento()));
+                }
+                while (!history.empty()) {
+                    originator.setMemento(*history.back());
+                    std::cout << "Undo state." << std::endl;
+                    delete history.back();
+                    history.pop_back();
+                }
+            }
+            pointer_rate = 2.0 * rounds * depth / elapsed_seconds(start) / 1e6;
+        }
+        {
+            MutedOutput muted;
+            CareTaker caretaker(&originator, depth);
+            //    :       
+            auto now = std::chrono::system_clock::now();
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                for (int i = 0; i < depth; ++i) {
+                    originator.setState(i);
+                    caretaker.save(now);
+                }
+                for (int i = 0; i < depth; ++i) caretaker.undo();
+            }
+            ring_rate = 2.0 * rounds * depth / elapsed_seconds(start) / 1e6;
+        }
+        std::cout << "Memento* + new: " << pointer_rate << "      \n";
+        std::cout << "MementoRing: " << ring_rate << "      \n";
+    }
+
+    //  :       64 ,   .
+    // ,    ,    ,    
+    void benchmark_memento_deep_undo() {
+        constexpr int snapshots = 1000000;
+        constexpr std::size_t budget = 64 * 1024;
+        Originator originator;
+        std::vector<double> latencies;
+        latencies.reserve(snapshots);
+        std::size_t resident = 0;
+        bool restored = true;
+        {
+            MutedOutput muted;
+            CareTaker caretaker(&originator, (std::filesystem::temp_directory_path() / "memento_bench.spill").string(), budget);
+            auto now = std::chrono::system_clock::now();
+            for (int i = 0; i < snapshots; ++i) {
+                originator.setState(i);
+                caretaker.save(now + std::chrono::microseconds(i));
+            }
+            resident = caretaker.residentBytes();
+            for (int i = snapshots - 1; i >= 0; --i) {
+                auto start = std::chrono::steady_clock::now();
+                caretaker.undo();
+                latencies.push_back(elapsed_seconds(start) * 1e9);
+                restored = restored && originator.getState() == i;
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "  " << snapshots << " : p50 " << latencies[latencies.size() / 2]
+            << " , p99 " << latencies[latencies.size() * 99 / 100] << " , p99.9 "
+            << latencies[latencies.size() * 999 / 1000] << " ,  " << latencies.back()
+            << " ,   " << resident << "    " << budget << "\n";
+        if (!restored) std::cout << "    \n";
+    }
+
+    //    SeqlockOriginator      ,
+    //        ( 0)
+    void benchmark_memento_checkpoints() {
+        constexpr int writers = 2, updates = 1000000;
+        auto measure = [](std::chrono::milliseconds* interval) {
+            SeqlockOriginator<Account> account;
+            std::unique_ptr<BackgroundCheckpointer<Account>> checkpointer;
+            if (interval) checkpointer = std::make_unique<BackgroundCheckpointer<Account>>(&account, *interval);
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int t = 0; t < writers; ++t)
+                threads.emplace_back([&account] {
+                    for (int i = 0; i < updates; ++i)
+                        account.update([](Account& a) { a.balance += 10; a.operations += 1; });
+                });
+            for (std::thread& thread : threads) thread.join();
+            return double(writers) * updates / elapsed_seconds(start) / 1e6;
+        };
+        std::chrono::milliseconds every_millisecond(1), continuously(0);
+        std::cout << "  : " << measure(nullptr) << "    \n";
+        std::cout << "     1 : " << measure(&every_millisecond) << "    \n";
+        std::cout << "   : " << measure(&continuously) << "    \n";
+    }
+
+    //        10  :    
+    //       128 ,     
+    void benchmark_memento_restore() {
+        constexpr int snapshots = 10000000, probes = 100000;
+        auto measure = [](CareTaker& caretaker, Originator& originator) {
+            auto epoch = std::chrono::system_clock::now();
+            for (int i = 0; i < snapshots; ++i) {
+                originator.setState(i);
+                caretaker.save(epoch + std::chrono::microseconds(i));
+            }
+            std::uint64_t seed = 88172645463325252ull;
+            bool restored = true;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < probes; ++i) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                int target = int(seed % snapshots);
+                caretaker.restoreTo(epoch + std::chrono::microseconds(target));
+                restored = restored && originator.getState() == target;
+            }
+            double ns = elapsed_seconds(start) * 1e9 / probes;
+            return std::make_pair(ns, restored);
+        };
+        std::pair<double, bool> memory, spilled;
+        {
+            MutedOutput muted;
+            Originator originator;
+            CareTaker caretaker(&originator, snapshots);
+            memory = measure(caretaker, originator);
+        }
+        {
+            MutedOutput muted;
+            Originator originator;
+            CareTaker caretaker(&originator, (std::filesystem::temp_directory_path() / "memento_restore.spill").string(), 128 * 1024);
+            spilled = measure(caretaker, originator);
+        }
+        std::cout << "restoreTo  " << snapshots << "   : " << memory.first << " \n";
+        std::cout << "restoreTo  " << snapshots << "   : " << spilled.first << " \n";
+        if (!memory.second || !spilled.second) std::cout << "restoreTo    \n";
+    }
+
+    // -      4 ,    
+    //   :         .
+    // keyframe_interval = 1    ,    
+    void benchmark_memento_delta() {
+        constexpr std::size_t document_size = std::size_t(4) << 20, saves = 128, edits = 4;
+        auto measure = [](std::size_t keyframe_interval) {
+            DocumentOriginator document;
+            document.resize(document_size);
+            DocumentCareTaker caretaker(&document, keyframe_interval);
+            std::vector<std::size_t> hashes;
+            std::uint64_t seed = 88172645463325252ull;
+            char text[64];
+            double save_seconds = 0;
+            for (std::size_t i = 0; i < saves; ++i) {
+                for (std::size_t e = 0; e < edits; ++e) {
+                    seed ^= seed << 13;
+                    seed ^= seed >> 7;
+                    seed ^= seed << 17;
+                    std::memset(text, int('a' + seed % 26), sizeof(text));
+                    document.write(std::size_t(seed % (document_size - sizeof(text))), text, sizeof(text));
+                }
+                hashes.push_back(std::hash<std::string_view>()(std::string_view(document.data(), document.size())));
+                auto start = std::chrono::steady_clock::now();
+                caretaker.save();
+                save_seconds += elapsed_seconds(start);
+            }
+            std::size_t bytes_per_save = caretaker.storedBytes() / saves;
+            std::vector<double> latencies;
+            bool restored = true;
+            MutedOutput muted;
+            for (std::size_t i = saves; i-- > 0;) {
+                auto start = std::chrono::steady_clock::now();
+                caretaker.undo();
+                latencies.push_back(elapsed_seconds(start) * 1e6);
+                restored = restored
+                    && std::hash<std::string_view>()(std::string_view(document.data(), document.size())) == hashes[i];
+            }
+            std::sort(latencies.begin(), latencies.end());
+            return std::make_tuple(bytes_per_save, save_seconds * 1e6 / saves,
+                latencies[latencies.size() / 2], latencies.back(), restored);
+        };
+        for (std::size_t interval : { std::size_t(1), std::size_t(16) }) {
+            auto [bytes, save_us, undo_p50, undo_max, restored] = measure(interval);
+            std::cout << (interval == 1 ? " " : ",    16")
+                << ": " << bytes << "   ,  " << save_us << " ,  p50 "
+                << undo_p50 << " ,  " << undo_max << " \n";
+            if (!restored) std::cout << "     \n";
+        }
+    }
+
+    void benchmark_memento() {
+        benchmark_memento_save_undo();
+        benchmark_memento_deep_undo();
+        benchmark_memento_checkpoints();
+        benchmark_memento_restore();
+        benchmark_memento_delta();
+    }
 }
\ No newline at end of file
@@ -8,6 +8,21 @@
 #pragma once
 #include<string>
 #include<iostream>
+#include<array>
+#include<cstddef>
+#include<cstdint>
+#include<type_traits>
+#include<algorithm>
+#include<thread>
+#include<vector>
+#include<atomic>
+#include<bit>
+#include<chrono>
+#include<condition_variable>
+#include<mutex>
+#include<stdexcept>
+#include<functional>
+#include<deque>
 
  // Концепция паттерна "Состояние"
 namespace Сoncept {
@@ -154,6 +169,553 @@ namespace Behavioral {
         std::cout << "Nothing happens" << std::endl;
     }
 
+    //--------------------------------------------------------------
+    // Табличный конечный автомат с состояниями-приспособленцами
+    //--------------------------------------------------------------
+    // Состояния не хранят данных и существуют в единственном экземпляре, поэтому
+    // контекст держит лишь номер состояния. Переходы берутся из таблицы
+    // [состояние][событие], которую можно построить на этапе компиляции (constexpr);
+    // переход - это одно обращение к таблице без выделения памяти.
+
+    enum class Phase : std::uint8_t { Solid, Liquid, Gas };
+    enum class PhaseEvent : std::uint8_t { Freeze, Heat };
+
+    template <class TState, class TEvent, std::size_t States, std::size_t Events>
+    class TransitionTable {
+    public:
+        // По умолчанию событие оставляет автомат в текущем состоянии
+        constexpr TransitionTable() : next() {
+            for (std::size_t s = 0; s < States; ++s)
+                for (std::size_t e = 0; e < Events; ++e)
+                    next[s][e] = TState(s);
+        }
+        constexpr TransitionTable& on(TState from, TEvent event, TState to) {
+            next[std::size_t(from)][std::size_t(event)] = to;
+            return *this;
+        }
+        constexpr TState operator()(TState from, TEvent event) const {
+            return next[std::size_t(from)][std::size_t(event)];
+        }
+        using state_type = TState;
+        using event_type = TEvent;
+        static constexpr std::size_t states = States;
+        static constexpr std::size_t events = Events;
+    private:
+        std::array<std::array<TState, Events>, States> next;
+    };
+
+    using PhaseTable = TransitionTable<Phase, PhaseEvent, 3, 2>;
+
+    inline constexpr PhaseTable phase_table = PhaseTable()
+        .on(Phase::Solid, PhaseEvent::Heat, Phase::Liquid)
+        .on(Phase::Liquid, PhaseEvent::Freeze, Phase::Solid)
+        .on(Phase::Liquid, PhaseEvent::Heat, Phase::Gas)
+        .on(Phase::Gas, PhaseEvent::Freeze, Phase::Liquid);
+
+    static_assert(phase_table(Phase::Solid, PhaseEvent::Heat) == Phase::Liquid);
+    static_assert(phase_table(Phase::Gas, PhaseEvent::Heat) == Phase::Gas);
+
+    // Приспособленец состояния: общий для всех автоматов, без изменяемых данных
+    class PhaseState final {
+    public:
+        constexpr PhaseState(Phase id, const char* name) : id(id), name(name) {}
+        Phase GetId() const { return id; }
+        const char* GetName() const { return name; }
+
+        static const PhaseState& Of(Phase phase) {
+            static constexpr PhaseState states[] = {
+                { Phase::Solid, "Solid" },
+                { Phase::Liquid, "Liquid" },
+                { Phase::Gas, "Gas" }
+            };
+            return states[std::size_t(phase)];
+        }
+    private:
+        Phase id;
+        const char* name;
+    };
+
+    template <const auto& Table>
+    class TableStateMachine {
+        using table_type = std::remove_cvref_t<decltype(Table)>;
+    public:
+        using state_type = typename table_type::state_type;
+        using event_type = typename table_type::event_type;
+
+        explicit TableStateMachine(state_type initial) : current(initial) {}
+
+        // Возвращает true, если событие сменило состояние
+        bool Fire(event_type event) {
+            state_type next = Table(current, event);
+            bool changed = next != current;
+            current = next;
+            return changed;
+        }
+        state_type GetState() const { return current; }
+    private:
+        state_type current;
+    };
+
+    using PhaseMachine = TableStateMachine<phase_table>;
+
+    // Аналог StateContext на табличном автомате: те же Freeze()/Heat(), но без new/delete
+    class PhaseContext {
+    private:
+        PhaseMachine machine;
+    public:
+        PhaseContext(Phase initial) : machine(initial) {}
+
+        void Freeze() { Apply(PhaseEvent::Freeze, "Freezing "); }
+        void Heat() { Apply(PhaseEvent::Heat, "Heating "); }
+        const PhaseState& GetState() const { return PhaseState::Of(machine.GetState()); }
+    private:
+        void Apply(PhaseEvent event, const char* action) {
+            const PhaseState& from = GetState();
+            std::cout << action << from.GetName() << "..." << std::endl;
+            if (machine.Fire(event))
+                std::cout << "Changing state from " << from.GetName()
+                    << " to " << GetState().GetName() << "..." << std::endl;
+            else
+                std::cout << "Nothing happens" << std::endl;
+        }
+    };
+
+    // Пакетная симуляция множества независимых автоматов: состояние сущности -
+    // один байт в непрерывном массиве (структура массивов) вместо объекта в куче.
+    // Событие применяется ко всему пакету одним проходом по массиву; замена по
+    // таблице записана как сравнения с выбором, которые компилятор векторизует.
+    // Большие пакеты делятся на части между потоками.
+    template <const auto& Table>
+    class StateBatch {
+        using table_type = std::remove_cvref_t<decltype(Table)>;
+        static_assert(table_type::states <= 256, "State id must fit into one byte");
+    public:
+        using state_type = typename table_type::state_type;
+        using event_type = typename table_type::event_type;
+
+        // Минимальный размер части пакета, ради которой стоит заводить поток
+        static constexpr std::size_t parallel_chunk = std::size_t(1) << 18;
+
+        StateBatch(std::size_t count, state_type initial) : states(count, std::uint8_t(initial)) {}
+
+        std::size_t size() const { return states.size(); }
+        state_type Get(std::size_t i) const { return state_type(states[i]); }
+        void Set(std::size_t i, state_type state) { states[i] = std::uint8_t(state); }
+
+        // Применяет событие к сущностям [first, last)
+        void Apply(event_type event, std::size_t first, std::size_t last) {
+            std::array<std::uint8_t, table_type::states> next;
+            for (std::size_t s = 0; s < next.size(); ++s)
+                next[s] = std::uint8_t(Table(state_type(s), event));
+
+            std::size_t count = last - first;
+            std::size_t workers = std::min<std::size_t>(std::thread::hardware_concurrency(), count / parallel_chunk);
+            if (workers <= 1) {
+                ApplyRange(states.data() + first, count, next);
+                return;
+            }
+            std::vector<std::thread> threads;
+            std::size_t chunk = (count + workers - 1) / workers;
+            for (std::size_t begin = first; begin < last; begin += chunk) {
+                std::size_t length = std::min(chunk, last - begin);
+                threads.emplace_back([this, begin, length, &next] { ApplyRange(states.data() + begin, length, next); });
+            }
+            for (std::thread& thread : threads) thread.join();
+        }
+        void Apply(event_type event) { Apply(event, 0, states.size()); }
+
+        // Число сущностей в каждом состоянии
+        std::array<std::size_t, table_type::states> Count() const {
+            std::array<std::size_t, table_type::states> counts{};
+            for (std::uint8_t s : states) ++counts[s];
+            return counts;
+        }
+    private:
+        static void ApplyRange(std::uint8_t* data, std::size_t count,
+            const std::array<std::uint8_t, table_type::states>& next) {
+            for (std::size_t i = 0; i < count; ++i) {
+                std::uint8_t state = data[i];
+                std::uint8_t result = state;
+                for (std::size_t s = 0; s < table_type::states; ++s)
+                    result = state == s ? next[s] : result;
+                data[i] = result;
+            }
+        }
+
+        std::vector<std::uint8_t> states;
+    };
+
+    using PhaseBatch = StateBatch<phase_table>;
+
+    // Событийный автомат: события не исполняются в месте вызова, а ставятся в
+    // очередь (Post) и обрабатываются диспетчером пачками (Dispatch). Переходы не
+    // печатаются, а пишутся в кольцевой журнал без блокировок, который можно
+    // выгрузить по запросу; по каждой паре состояний ведётся счётчик переходов.
+
+    struct TransitionRecord {
+        std::uint32_t machine;
+        std::uint8_t from;
+        std::uint8_t to;
+        std::uint8_t event;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    // Кольцо фиксированного размера на произвольное число писателей. Каждая ячейка
+    // снабжена номером записи: нечётный - запись идёт, чётный - завершена. Писатель
+    // захватывает ячейку сравнением с обменом, поэтому после оборота кольца в ячейку
+    // пишет только один писатель: отставший на круг ждёт, пока допишет предыдущий,
+    // и отказывается от записи, если ячейку уже занял более новый. Читатель
+    // не блокирует писателей и пропускает ячейки, перезаписанные во время чтения.
+    class TransitionTrace {
+    public:
+        explicit TransitionTrace(std::size_t capacity) : slots(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {}
+
+        void Record(const TransitionRecord& record) {
+            std::uint64_t ticket = head.fetch_add(1, std::memory_order_relaxed);
+            Slot& slot = slots[ticket & (slots.size() - 1)];
+            std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            for (;;) {
+                // Ячейку уже заняла запись с более поздним номером: наша всё равно была бы затёрта
+                if (sequence >= 2 * ticket + 1) return;
+                if (sequence & 1) {
+                    std::this_thread::yield();
+                    sequence = slot.sequence.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (slot.sequence.compare_exchange_weak(sequence, 2 * ticket + 1, std::memory_order_relaxed))
+                    break;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.data.store(Pack(record), std::memory_order_relaxed);
+            slot.time.store(record.time.time_since_epoch().count(), std::memory_order_relaxed);
+            slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+        }
+
+        // Последние записи в порядке их появления
+        std::vector<TransitionRecord> Snapshot() const {
+            std::uint64_t end = head.load(std::memory_order_acquire);
+            std::uint64_t begin = end > slots.size() ? end - slots.size() : 0;
+            std::vector<TransitionRecord> records;
+            records.reserve(std::size_t(end - begin));
+            for (std::uint64_t ticket = begin; ticket < end; ++ticket) {
+                const Slot& slot = slots[ticket & (slots.size() - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != 2 * ticket + 2) continue;
+                std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+                std::int64_t time = slot.time.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != 2 * ticket + 2) continue;
+                records.push_back(Unpack(data, time));
+            }
+            return records;
+        }
+        std::size_t capacity() const { return slots.size(); }
+    private:
+        using duration = std::chrono::steady_clock::duration;
+
+        struct Slot {
+            std::atomic<std::uint64_t> sequence{ 0 };
+            std::atomic<std::uint64_t> data{ 0 };
+            std::atomic<std::int64_t> time{ 0 };
+        };
+
+        static std::uint64_t Pack(const TransitionRecord& r) {
+            return std::uint64_t(r.machine) << 32 | std::uint64_t(r.from) << 16 | std::uint64_t(r.to) << 8 | r.event;
+        }
+        static TransitionRecord Unpack(std::uint64_t data, std::int64_t time) {
+            return { std::uint32_t(data >> 32), std::uint8_t(data >> 16), std::uint8_t(data >> 8), std::uint8_t(data),
+                std::chrono::steady_clock::time_point(duration(time)) };
+        }
+
+        std::vector<Slot> slots;
+        std::atomic<std::uint64_t> head{ 0 };
+    };
+
+    template <const auto& Table>
+    class StateRuntime {
+        using table_type = std::remove_cvref_t<decltype(Table)>;
+        static constexpr std::size_t states = table_type::states;
+    public:
+        using state_type = typename table_type::state_type;
+        using event_type = typename table_type::event_type;
+
+        explicit StateRuntime(std::size_t trace_capacity = 4096) : trace(trace_capacity) {}
+        ~StateRuntime() { Stop(); }
+
+        StateRuntime(const StateRuntime&) = delete;
+        StateRuntime& operator=(const StateRuntime&) = delete;
+
+        // Автоматы добавляются до запуска диспетчера
+        std::uint32_t AddMachine(state_type initial) {
+            machines.emplace_back(initial);
+            return std::uint32_t(machines.size() - 1);
+        }
+        // Можно читать во время работы диспетчера: состояние атомарно, но может
+        // отставать от уже поставленных в очередь событий
+        state_type GetState(std::uint32_t machine) const { return machines[machine].load(std::memory_order_acquire); }
+        std::size_t size() const { return machines.size(); }
+
+        // Ставит событие в очередь; безопасно из любого потока
+        void Post(std::uint32_t machine, event_type event) {
+            if (machine >= machines.size())
+                throw std::out_of_range("Unknown state machine");
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back({ machine, event });
+            }
+            wake.notify_one();
+        }
+
+        // Обрабатывает всё, что накопилось в очереди, одной пачкой; возвращает число событий.
+        // Вызывается из одного потока - либо вручную, либо фоновым диспетчером (Start).
+        std::size_t Dispatch() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batch.swap(pending);
+            }
+            auto now = std::chrono::steady_clock::now();
+            for (const Posted& posted : batch) {
+                state_type from = machines[posted.machine].load(std::memory_order_relaxed);
+                state_type to = Table(from, posted.event);
+                machines[posted.machine].store(to, std::memory_order_release);
+                counters[std::size_t(from) * states + std::size_t(to)].fetch_add(1, std::memory_order_relaxed);
+                trace.Record({ posted.machine, std::uint8_t(from), std::uint8_t(to), std::uint8_t(posted.event), now });
+            }
+            std::size_t count = batch.size();
+            batch.clear();
+            return count;
+        }
+
+        // Фоновый диспетчер: просыпается при появлении событий
+        void Start() {
+            if (dispatcher.joinable())
+                throw std::logic_error("Dispatcher is already running");
+            stopping = false;
+            dispatcher = std::thread([this] {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;) {
+                    wake.wait(lock, [this] { return stopping || !pending.empty(); });
+                    if (pending.empty()) return;
+                    lock.unlock();
+                    Dispatch();
+                    lock.lock();
+                }
+            });
+        }
+        // Останавливает диспетчер, предварительно обработав очередь
+        void Stop() {
+            if (!dispatcher.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            dispatcher.join();
+        }
+
+        // Число событий, переведших автомат из from в to (from == to - событие без смены состояния)
+        std::uint64_t Transitions(state_type from, state_type to) const {
+            return counters[std::size_t(from) * states + std::size_t(to)].load(std::memory_order_relaxed);
+        }
+        std::vector<TransitionRecord> Trace() const { return trace.Snapshot(); }
+
+        // Выгружает журнал; names - функция, возвращающая имя состояния
+        template <class Names>
+        void Dump(std::ostream& out, Names names) const {
+            for (const TransitionRecord& r : trace.Snapshot())
+                out << "#" << r.machine << ": " << names(state_type(r.from))
+                    << " -> " << names(state_type(r.to)) << std::endl;
+        }
+    private:
+        struct Posted {
+            std::uint32_t machine;
+            event_type event;
+        };
+
+        // deque: атомарные ячейки не перемещаются при добавлении автомата
+        std::deque<std::atomic<state_type>> machines;
+        std::vector<Posted> pending;
+        std::vector<Posted> batch;
+        std::array<std::atomic<std::uint64_t>, states * states> counters{};
+        TransitionTrace trace;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::thread dispatcher;
+    };
+
+    using PhaseRuntime = StateRuntime<phase_table>;
+
+    // Иерархический автомат: состояния вложены друг в друга и имеют действия
+    // входа и выхода. Событие, не обработанное состоянием, наследуется от
+    // родителя. Все пути переходов вычисляются один раз при построении: для
+    // каждой пары (текущее состояние, событие) хранится целевое состояние и
+    // готовый список действий выхода/входа через наименьшего общего предка, так
+    // что переход во время работы не обходит дерево.
+    class HierarchicalMachine {
+    public:
+        using StateId = std::uint32_t;
+        using EventId = std::uint32_t;
+        using Action = std::function<void()>;
+        static constexpr StateId none = StateId(-1);
+
+        class Builder {
+        public:
+            explicit Builder(std::size_t events) : events(events) {}
+
+            // Родитель должен быть добавлен раньше потомка
+            StateId AddState(std::string name, StateId parent = none, Action entry = {}, Action exit = {}) {
+                if (parent != none && parent >= states.size())
+                    throw std::invalid_argument("Unknown parent state");
+                states.push_back({ std::move(name), parent, none, std::move(entry), std::move(exit) });
+                handlers.resize(states.size() * events, none);
+                return StateId(states.size() - 1);
+            }
+            // Вход в state продолжается во вложенное состояние child
+            Builder& Initial(StateId state, StateId child) {
+                if (child >= states.size() || states[child].parent != state)
+                    throw std::invalid_argument("Initial state must be a direct child");
+                states[state].initial = child;
+                return *this;
+            }
+            Builder& On(StateId state, EventId event, StateId target) {
+                if (state >= states.size() || target >= states.size() || event >= events)
+                    throw std::invalid_argument("Unknown state or event");
+                handlers[state * events + event] = target;
+                return *this;
+            }
+
+            HierarchicalMachine Build(StateId initial) const {
+                if (initial >= states.size())
+                    throw std::invalid_argument("Unknown initial state");
+                HierarchicalMachine machine;
+                machine.events = events;
+                for (const Node& node : states) {
+                    machine.names.push_back(node.name);
+                    machine.parents.push_back(node.parent);
+                    machine.actions.push_back(node.exit);
+                    machine.actions.push_back(node.entry);
+                }
+                // Вход в initial от корня: все его предки и начальные потомки
+                std::vector<StateId> chain = Ancestors(initial);
+                for (auto state = chain.rbegin(); state != chain.rend(); ++state)
+                    AddEntry(machine.start, *state);
+                machine.current = Descend(machine.start, initial);
+
+                machine.table.resize(states.size() * events);
+                for (StateId source = 0; source < states.size(); ++source) {
+                    for (EventId event = 0; event < events; ++event) {
+                        // Обработчик наследуется от ближайшего предка
+                        StateId target = none;
+                        for (StateId s = source; s != none && target == none; s = states[s].parent)
+                            target = handlers[s * events + event];
+                        Transition& transition = machine.table[source * events + event];
+                        transition.first = std::uint32_t(machine.steps.size());
+                        if (target == none) {
+                            transition.target = none;
+                            continue;
+                        }
+                        // Выход до наименьшего общего собственного предка и вход до цели
+                        StateId lca = CommonAncestor(source, target);
+                        for (StateId s = source; s != lca; s = states[s].parent)
+                            AddExit(machine.steps, s);
+                        std::vector<StateId> entries;
+                        for (StateId s = target; s != lca; s = states[s].parent)
+                            entries.push_back(s);
+                        for (auto state = entries.rbegin(); state != entries.rend(); ++state)
+                            AddEntry(machine.steps, *state);
+                        transition.target = Descend(machine.steps, target);
+                        transition.count = std::uint32_t(machine.steps.size() - transition.first);
+                    }
+                }
+                return machine;
+            }
+        private:
+            struct Node {
+                std::string name;
+                StateId parent;
+                StateId initial;
+                Action entry;
+                Action exit;
+            };
+
+            // Состояние и все его предки, от него к корню
+            std::vector<StateId> Ancestors(StateId state) const {
+                std::vector<StateId> chain;
+                for (; state != none; state = states[state].parent)
+                    chain.push_back(state);
+                return chain;
+            }
+            // Ближайший предок, строго содержащий оба состояния (none - корень);
+            // при переходе в себя или в предка состояние покидается и входится заново
+            StateId CommonAncestor(StateId source, StateId target) const {
+                std::vector<StateId> chain = Ancestors(target);
+                for (StateId s = states[source].parent; s != none; s = states[s].parent)
+                    if (s != target && std::find(chain.begin(), chain.end(), s) != chain.end())
+                        return s;
+                return none;
+            }
+            StateId Descend(std::vector<std::uint32_t>& steps, StateId state) const {
+                for (; states[state].initial != none; state = states[state].initial)
+                    AddEntry(steps, states[state].initial);
+                return state;
+            }
+            void AddExit(std::vector<std::uint32_t>& steps, StateId state) const {
+                if (states[state].exit) steps.push_back(2 * state);
+            }
+            void AddEntry(std::vector<std::uint32_t>& steps, StateId state) const {
+                if (states[state].entry) steps.push_back(2 * state + 1);
+            }
+
+            std::size_t events;
+            std::vector<Node> states;
+            std::vector<StateId> handlers;
+        };
+
+        // Выполняет действия входа в начальное состояние
+        void Start() {
+            for (std::uint32_t step : start) actions[step]();
+        }
+
+        // Возвращает false, если ни состояние, ни его предки не обрабатывают событие
+        bool Fire(EventId event) {
+            const Transition& transition = table[current * events + event];
+            if (transition.target == none) return false;
+            const std::uint32_t* step = steps.data() + transition.first;
+            for (std::uint32_t i = 0; i < transition.count; ++i)
+                actions[step[i]]();
+            current = transition.target;
+            return true;
+        }
+
+        StateId GetState() const { return current; }
+        const std::string& GetName(StateId state) const { return names[state]; }
+        // Находится ли автомат в state или в одном из его потомков
+        bool IsIn(StateId state) const {
+            for (StateId s = current; s != none; s = parents[s])
+                if (s == state) return true;
+            return false;
+        }
+    private:
+        HierarchicalMachine() = default;
+
+        struct Transition {
+            StateId target = none;
+            std::uint32_t first = 0;
+            std::uint32_t count = 0;
+        };
+
+        std::size_t events = 0;
+        StateId current = none;
+        std::vector<std::string> names;
+        std::vector<StateId> parents;
+        // Действия выхода (2 * s) и входа (2 * s + 1); в списки попадают только непустые
+        std::vector<Action> actions;
+        std::vector<Transition> table;
+        std::vector<std::uint32_t> steps;
+        std::vector<std::uint32_t> start;
+    };
+
     void test_state() {
         StateContext* sc = new StateContext(new SolidState());
         sc->Heat();
@@ -163,5 +725,175 @@ namespace Behavioral {
         sc->Freeze();
         sc->Freeze();
         delete sc;
+
+        PhaseContext pc(Phase::Solid);
+        pc.Heat();
+        pc.Heat();
+        pc.Heat();
+        pc.Freeze();
+        pc.Freeze();
+        pc.Freeze();
+
+        // Миллион сущностей: нагрев всех, затем охлаждение первой половины
+        PhaseBatch batch(1000000, Phase::Solid);
+        batch.Apply(PhaseEvent::Heat);
+        batch.Apply(PhaseEvent::Heat);
+        batch.Apply(PhaseEvent::Freeze, 0, batch.size() / 2);
+        auto counts = batch.Count();
+        std::cout << "Solid: " << counts[0] << ", Liquid: " << counts[1]
+            << ", Gas: " << counts[2] << std::endl;
+
+        // События ставятся в очередь и обрабатываются диспетчером пачкой
+        PhaseRuntime runtime;
+        std::uint32_t ice = runtime.AddMachine(Phase::Solid);
+        std::uint32_t steam = runtime.AddMachine(Phase::Gas);
+        runtime.Post(ice, PhaseEvent::Heat);
+        runtime.Post(steam, PhaseEvent::Freeze);
+        runtime.Post(ice, PhaseEvent::Heat);
+        runtime.Post(steam, PhaseEvent::Freeze);
+        runtime.Dispatch();
+        runtime.Dump(std::cout, [](Phase phase) { return PhaseState::Of(phase).GetName(); });
+        std::cout << "Liquid -> Gas: " << runtime.Transitions(Phase::Liquid, Phase::Gas) << std::endl;
+
+        // Вложенные состояния: Water включает Solid и Liquid, начальное - Solid
+        enum : HierarchicalMachine::EventId { Heat, Freeze, Events };
+        auto trace = [](const char* action) { return [action] { std::cout << action << std::endl; }; };
+        HierarchicalMachine::Builder builder(Events);
+        auto water = builder.AddState("Water", HierarchicalMachine::none, trace("Enter Water"), trace("Exit Water"));
+        auto solid = builder.AddState("Solid", water, trace("Enter Solid"), trace("Exit Solid"));
+        auto liquid = builder.AddState("Liquid", water, trace("Enter Liquid"), trace("Exit Liquid"));
+        auto gas = builder.AddState("Gas", HierarchicalMachine::none, trace("Enter Gas"), trace("Exit Gas"));
+        builder.Initial(water, solid)
+            .On(solid, Heat, liquid)
+            .On(liquid, Heat, gas)
+            .On(water, Freeze, solid)
+            .On(gas, Freeze, water);
+        HierarchicalMachine hsm = builder.Build(water);
+        hsm.Start();
+        hsm.Fire(Heat);
+        hsm.Fire(Heat);
+        hsm.Fire(Freeze);
+        std::cout << "Actual state is " << hsm.GetName(hsm.GetState()) << std::endl;
+    }
+
+    // Переходы в секунду: StateContext с new/delete на каждый переход против PhaseContext
+    // на таблице и голого PhaseMachine. Оба контекста печатают каждый переход, поэтому
+    // вывод на время замера выключается, а цикл Heat, Heat, Freeze, Freeze меняет
+    // состояние на каждом событии.
+    void benchmark_state_transitions() {
+        constexpr int cycles = 1000000;
+        auto rate = [](std::chrono::steady_clock::time_point start) {
+            return 4.0 * cycles / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 1e6;
+        };
+        std::ios::iostate output = std::cout.rdstate();
+        std::cout.setstate(std::ios::badbit);
+        StateContext context(new SolidState());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < cycles; ++i) {
+            context.Heat();
+            context.Heat();
+            context.Freeze();
+            context.Freeze();
+        }
+        double class_rate = rate(start);
+        PhaseContext table_context(Phase::Solid);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < cycles; ++i) {
+            table_context.Heat();
+            table_context.Heat();
+            table_context.Freeze();
+            table_context.Freeze();
+        }
+        double table_rate = rate(start);
+        std::cout.clear(output);
+
+        // События читаются из массива, иначе компилятор свернёт постоянный цикл
+        std::vector<PhaseEvent> events(4096);
+        for (std::size_t i = 0; i < events.size(); ++i)
+            events[i] = i % 4 < 2 ? PhaseEvent::Heat : PhaseEvent::Freeze;
+        PhaseMachine machine(Phase::Solid);
+        std::size_t changes = 0;
+        start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < 4 * std::size_t(cycles); ++i)
+            changes += machine.Fire(events[i % events.size()]);
+        double machine_rate = rate(start);
+        std::cout << "StateContext: " << class_rate << " млн переходов в секунду\n";
+        std::cout << "PhaseContext: " << table_rate << " млн переходов в секунду\n";
+        std::cout << "PhaseMachine без вывода: " << machine_rate << " млн переходов в секунду, переходов "
+            << changes << " из " << 4 * cycles << "\n";
     }
-}
\ No newline at end of file
+
+    // Переход между листьями двух ветвей глубины depth: HierarchicalMachine выполняет
+    // готовый список действий, наивный автомат на каждом событии ищет обработчик среди
+    // предков, общего предка и путь входа обходом дерева
+    void benchmark_hierarchical_state() {
+        using Machine = HierarchicalMachine;
+        struct NaiveMachine {
+            std::vector<Machine::StateId> parents;
+            std::vector<Machine::StateId> handlers;  // одно событие на состояние
+            std::vector<Machine::Action> entries, exits;
+            Machine::StateId current = Machine::none;
+
+            void Fire() {
+                Machine::StateId target = Machine::none;
+                for (Machine::StateId s = current; s != Machine::none && target == Machine::none; s = parents[s])
+                    target = handlers[s];
+                std::vector<Machine::StateId> chain;
+                for (Machine::StateId s = target; s != Machine::none; s = parents[s]) chain.push_back(s);
+                Machine::StateId lca = Machine::none;
+                for (Machine::StateId s = parents[current]; s != Machine::none && lca == Machine::none; s = parents[s])
+                    if (s != target && std::find(chain.begin(), chain.end(), s) != chain.end()) lca = s;
+                for (Machine::StateId s = current; s != lca; s = parents[s]) exits[s]();
+                std::vector<Machine::StateId> path;
+                for (Machine::StateId s = target; s != lca; s = parents[s]) path.push_back(s);
+                for (auto s = path.rbegin(); s != path.rend(); ++s) entries[*s]();
+                current = target;
+            }
+        };
+
+        constexpr int transitions = 200000;
+        for (std::size_t depth : { 4, 16, 64 }) {
+            long actions = 0, naive_actions = 0;
+            Machine::Action count = [&actions] { ++actions; };
+            Machine::Action naive_count = [&naive_actions] { ++naive_actions; };
+            Machine::Builder builder(1);
+            NaiveMachine naive;
+            Machine::StateId root = builder.AddState("Root");
+            naive.parents.push_back(Machine::none);
+            naive.entries.push_back([] {});
+            naive.exits.push_back([] {});
+            Machine::StateId leaves[2];
+            for (Machine::StateId& leaf : leaves) {
+                leaf = root;
+                for (std::size_t level = 0; level < depth; ++level) {
+                    naive.parents.push_back(leaf);
+                    naive.entries.push_back(naive_count);
+                    naive.exits.push_back(naive_count);
+                    leaf = builder.AddState("State", leaf, count, count);
+                }
+            }
+            naive.handlers.assign(naive.parents.size(), Machine::none);
+            builder.On(leaves[0], 0, leaves[1]).On(leaves[1], 0, leaves[0]);
+            naive.handlers[leaves[0]] = leaves[1];
+            naive.handlers[leaves[1]] = leaves[0];
+            Machine machine = builder.Build(leaves[0]);
+            naive.current = leaves[0];
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < transitions; ++i) machine.Fire(0);
+            double precomputed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / transitions;
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < transitions; ++i) naive.Fire();
+            double walked = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / transitions;
+            std::cout << "Глубина " << depth << ": готовые пути " << precomputed << " нс, обход дерева "
+                << walked << " нс на переход";
+            if (actions != naive_actions || machine.GetState() != naive.current) std::cout << ", автоматы разошлись";
+            std::cout << "\n";
+        }
+    }
+
+    void benchmark_state() {
+        benchmark_state_transitions();
+        benchmark_hierarchical_state();
+    }
+}
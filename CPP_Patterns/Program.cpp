@@ -30,7 +30,16 @@ namespace Pattern {
 	using std::cout;
 	using std::cin;
 
-	void run() {
+	// Замеры производительности поведенческих паттернов
+	void run_benchmarks(const string& self) {
+		Behavioral::benchmark_command(self);
+		Behavioral::benchmark_memento();
+		Behavioral::benchmark_state();
+		Behavioral::benchmark_chain();
+		Behavioral::benchmark_mediator();
+	}
+
+	void run(const string& self) {
 		string result;
 		string info = "\n--------------------------------"
 			"\nВыберите команду:"
@@ -58,6 +67,7 @@ namespace Pattern {
 			"\n21 - Паттерн \"Заместитель\""
 			"\n22 - Паттерн \"Мост\""
 			"\n23 - Паттерн \"Приспособленец\""
+			"\nb  - Замеры производительности"
 			"\n--------------------------------\n";
 
 		while (true) {
@@ -66,6 +76,10 @@ namespace Pattern {
 
 			try {
 				if (result == "q") return;
+				if (result == "b") {
+					run_benchmarks(self);
+					continue;
+				}
 				int res = stoi(result);
 			}
 			catch (...) {
@@ -107,7 +121,10 @@ namespace Pattern {
 // ---------------------------------------------------------------
 int main(int argc, char** argv) {
 	setlocale(0, "");
-	Pattern::run();
+	// Резервный процесс для замера репликации команд
+	if (argc == 3 && std::string(argv[1]) == "--pult-replica")
+		return Behavioral::run_pult_replica(argv[2]);
+	Pattern::run(argv[0]);
 	return 0;
 }
 // ---------------------------------------------------------------
\ No newline at end of file